@@ -29,7 +29,9 @@
 #include "logger.hpp"
 
 #include <array>
+#include <cstring>
 #include <magic_enum.hpp>
+#include <stdexcept>
 
 #ifdef AGGRESIVE_LOGGING
 using namespace magic_enum::ostream_operators;
@@ -59,6 +61,16 @@ auto assembler::run() -> int {
             LOG_MSG("Comment.\n");
             break;
         case '.': {
+            auto name_end = std::size_t {1};
+            while (name_end < line.size() and is_label_char(line[name_end])) {
+                name_end++;
+            }
+            // Directives may have a ':' in their arguments, e.g. in strings
+            if (name_end == line.size() or line[name_end] != ':') {
+                LOG_MSG("directive handling");
+                handle_directive(line);
+                break;
+            }
             LOG_MSG("label handling");
             auto label = get_label(line);
             if (_labels.find(label) != _labels.end()) {
@@ -76,6 +88,12 @@ auto assembler::run() -> int {
                 // TODO: add function to consume comments
                 break;
             }
+            if (_data_start.has_value()) {
+                report_to_user(level::error, "Instructions cannot follow "
+                                             ".data, in line '"
+                                                 + line + "'.");
+                break;
+            }
             auto op = get_opcode(line);
             switch (get_category(op)) {
             case opcode_category::nullary:
@@ -92,7 +110,8 @@ auto assembler::run() -> int {
                     auto num_candidate =
                         std::string {line.begin() + num_start, line.end()};
                     try {
-                        return std::stoull(num_candidate, nullptr);
+                        // Base 0 accepts hex, which suits masks
+                        return std::stoull(num_candidate, nullptr, 0);
                     } catch (const std::out_of_range& e) {
                         // error
                         return 0;
@@ -104,13 +123,20 @@ auto assembler::run() -> int {
             }
             case opcode_category::unary_label: {
                 std::size_t label_start = line.find_first_of(' ');
-                while (not std::isalpha(line[label_start])) {
+                while (label_start < line.size()
+                       and not is_label_char(line[label_start])) {
                     label_start++;
                 }
                 std::size_t label_end = label_start;
-                while (std::isalpha(line[label_start])) {
+                while (label_end < line.size()
+                       and is_label_char(line[label_end])) {
                     label_end++;
                 }
+                if (label_start == label_end) {
+                    report_to_user(level::error,
+                                   "Missing label in line '" + line + "'.");
+                    break;
+                }
                 emit(op, std::string {line.begin() + label_start,
                                       line.begin() + label_end});
                 break;
@@ -133,6 +159,67 @@ auto assembler::run() -> int {
                 emit(op, regs.value());
                 break;
             }
+            case opcode_category::binary_register_then_constant: {
+                auto label_start = line.find_first_of('.');
+                if (op == common::opcode::movi
+                    and label_start != std::string::npos) {
+                    // `movi r1, .label` loads the address of the label, for
+                    // use with jmpr and callr
+                    auto reg       = get_register(line);
+                    auto label_end = label_start + 1;
+                    while (label_end < line.size()
+                           and is_label_char(line[label_end])) {
+                        label_end++;
+                    }
+                    if (not reg.has_value() or label_end == label_start + 1) {
+                        report_to_user(level::error, "Bad operands in line '"
+                                                         + line + "'.");
+                        break;
+                    }
+                    emit(op, reg.value(),
+                         address_of({line.begin() + label_start + 1,
+                                     line.begin() + label_end},
+                                    _pc + 2));
+                    break;
+                }
+                if (op == common::opcode::fmovi) {
+                    // The constant of fmovi is a double, emitted as its bits
+                    auto reg       = get_register(line);
+                    auto num_start = line.find_first_of(',');
+                    if (not reg.has_value() or num_start == std::string::npos) {
+                        report_to_user(level::error, "Bad operands in line '"
+                                                         + line + "'.");
+                        break;
+                    }
+                    double num {};
+                    try {
+                        num = std::stod(line.substr(num_start + 1));
+                    } catch (const std::logic_error&) {
+                        report_to_user(level::error, "Bad constant in line '"
+                                                         + line + "'.");
+                        break;
+                    }
+                    std::uint64_t bits {};
+                    std::memcpy(&bits, &num, sizeof(bits));
+                    emit(op, reg.value(), bits);
+                    break;
+                }
+                auto reg_and_num = get_register_and_constant(line);
+                if (not reg_and_num.has_value()) {
+                    break;
+                }
+                emit(op, reg_and_num.value().first,
+                     reg_and_num.value().second);
+                break;
+            }
+            case opcode_category::ternary_registers: {
+                auto regs = get_register_triple(line);
+                if (not regs.has_value()) {
+                    break;
+                }
+                emit(op, regs.value());
+                break;
+            }
             case opcode_category::binary_byte_then_register: {
                 auto byte_and_reg = get_io_op_and_reg(line);
                 if (not byte_and_reg.has_value()) {
@@ -142,6 +229,51 @@ auto assembler::run() -> int {
                      byte_and_reg.value().second);
                 break;
             }
+            case opcode_category::ternary_byte_then_registers: {
+                auto op_and_regs = get_vec_op_and_regs(line);
+                if (not op_and_regs.has_value()) {
+                    break;
+                }
+                emit(op, op_and_regs.value().first,
+                     op_and_regs.value().second);
+                break;
+            }
+            case opcode_category::binary_registers_then_condition: {
+                auto regs = get_register_pair(line);
+                auto cond = get_condition(line);
+                if (not regs.has_value() or not cond.has_value()) {
+                    break;
+                }
+                emit(op, regs.value(), cond.value());
+                break;
+            }
+            case opcode_category::ternary_registers_then_condition: {
+                auto regs = get_register_triple(line);
+                auto cond = get_condition(line);
+                if (not regs.has_value() or not cond.has_value()) {
+                    break;
+                }
+                emit(op, regs.value(), cond.value());
+                break;
+            }
+            case opcode_category::register_then_label: {
+                auto reg_and_label = get_register_and_label(line);
+                if (not reg_and_label.has_value()) {
+                    break;
+                }
+                emit(op, reg_and_label.value().first,
+                     reg_and_label.value().second);
+                break;
+            }
+            case opcode_category::register_then_labels: {
+                auto reg_and_labels = get_register_and_labels(line);
+                if (not reg_and_labels.has_value()) {
+                    break;
+                }
+                emit(op, reg_and_labels.value().first,
+                     reg_and_labels.value().second);
+                break;
+            }
             }
             break;
         }
@@ -151,10 +283,139 @@ auto assembler::run() -> int {
             break;
         }
     }
-    emit(common::opcode::halt);
+    if (not _data_start.has_value()) {
+        emit(common::opcode::halt);
+    }
+    emit_remaining_labels();
+    write_features();
     return 0;
 }
 
+auto assembler::handle_directive(const std::string& line) -> void {
+    LOG1(line);
+    auto name_end  = line.find_first_of(" \t");
+    auto directive = line.substr(1, name_end - 1);
+    auto try_parse_num = [&](std::uint64_t& num) -> bool {
+        if (name_end == std::string::npos) {
+            report_to_user(level::error, "Directive '" + directive
+                                             + "' expects an argument.");
+            return false;
+        }
+        try {
+            num = std::stoull(line.substr(name_end), nullptr, 0);
+            return true;
+        } catch (const std::logic_error& e) {
+            report_to_user(level::error, "The argument in line '" + line
+                                             + "' is not a valid number.");
+            return false;
+        }
+    };
+    if (directive == "memory") {
+        std::uint64_t size;
+        if (not try_parse_num(size)) {
+            return;
+        }
+        // The VM only accepts multiples of 64KiB, so we round up
+        constexpr std::uint64_t granularity = 64 * 1024;
+        size = (size + granularity - 1) / granularity * granularity;
+        if (size > std::uint64_t {1} << 32) {
+            report_to_user(level::error, "The linear memory cannot be larger "
+                                         "than 4GiB.");
+            return;
+        }
+        _memory_size = size;
+        return;
+    }
+    if (directive == "heap") {
+        std::uint64_t base;
+        if (not try_parse_num(base)) {
+            return;
+        }
+        constexpr std::uint64_t granularity = 64 * 1024;
+        if (base == 0 || base % granularity != 0) {
+            report_to_user(level::error, "The heap must start at a nonzero "
+                                         "multiple of 64KiB.");
+            return;
+        }
+        _heap_base = base;
+        return;
+    }
+    if (directive == "data") {
+        if (_data_start.has_value()) {
+            report_to_user(level::error, ".data can only be used once.");
+            return;
+        }
+        // Code running off its end halts instead of executing the data
+        emit(common::opcode::halt);
+        _data_start = _pc;
+        return;
+    }
+    if ((directive == "string" or directive == "u64")
+        and not _data_start.has_value()) {
+        report_to_user(level::error, "Directive '" + directive
+                                         + "' can only be used after .data.");
+        return;
+    }
+    if (directive == "string") {
+        auto open  = line.find_first_of('"');
+        auto close = line.find_last_of('"');
+        if (open == std::string::npos or open == close) {
+            report_to_user(level::error, "Directive 'string' expects a quoted "
+                                         "string, in line '"
+                                             + line + "'.");
+            return;
+        }
+        std::string bytes;
+        for (auto i = open + 1; i < close; i++) {
+            if (line[i] != '\\' or i + 1 == close) {
+                bytes.push_back(line[i]);
+                continue;
+            }
+            switch (line[++i]) {
+            case 'n':
+                bytes.push_back('\n');
+                break;
+            case 't':
+                bytes.push_back('\t');
+                break;
+            case '0':
+                bytes.push_back('\0');
+                break;
+            default:
+                // Covers \\ and \"
+                bytes.push_back(line[i]);
+                break;
+            }
+        }
+        emit_data(bytes);
+        return;
+    }
+    if (directive == "u64") {
+        std::string bytes;
+        for (auto num_start = name_end; num_start != std::string::npos;) {
+            auto num_end = line.find_first_of(',', num_start + 1);
+            auto text    = line.substr(num_start + 1, num_end - num_start - 1);
+            std::uint64_t num;
+            try {
+                num = std::stoull(text, nullptr, 0);
+            } catch (const std::logic_error& e) {
+                report_to_user(level::error, "The argument in line '" + line
+                                                 + "' is not a valid number.");
+                return;
+            }
+            // Like the linear memory, the data section is little endian
+            for (int i = 0; i < 8; i++) {
+                bytes.push_back(static_cast<char>(num >> (8 * i)));
+            }
+            num_start = num_end;
+        }
+        emit_data(bytes);
+        return;
+    }
+    report_to_user(level::error,
+                   "'" + directive + "' is not a valid directive.");
+}
+
 auto assembler::write_preamble() -> void {
     _out.write(common::magic_byte_string,
                sizeof(common::magic_byte_string) - 1);
@@ -181,6 +442,50 @@ auto assembler::write_preamble() -> void {
     _out.seekp(256);
 }
 
+auto assembler::write_features() -> void {
+    _out.seekp(sizeof(common::magic_byte_string) - 1 + 10);
+    if (_memory_size.has_value()) {
+        const auto size    = _memory_size.value();
+        const char bytes[] = {static_cast<char>(common::feature::memory),
+                              static_cast<char>(size >> 56),
+                              static_cast<char>((size << 8) >> 56),
+                              static_cast<char>((size << 16) >> 56),
+                              static_cast<char>((size << 24) >> 56),
+                              static_cast<char>((size << 32) >> 56),
+                              static_cast<char>((size << 40) >> 56),
+                              static_cast<char>((size << 48) >> 56),
+                              static_cast<char>((size << 56) >> 56)};
+        _out.write(bytes, sizeof(bytes));
+    }
+    if (_heap_base.has_value()) {
+        const auto base    = _heap_base.value();
+        const char bytes[] = {static_cast<char>(common::feature::heap),
+                              static_cast<char>(base >> 56),
+                              static_cast<char>((base << 8) >> 56),
+                              static_cast<char>((base << 16) >> 56),
+                              static_cast<char>((base << 24) >> 56),
+                              static_cast<char>((base << 32) >> 56),
+                              static_cast<char>((base << 40) >> 56),
+                              static_cast<char>((base << 48) >> 56),
+                              static_cast<char>((base << 56) >> 56)};
+        _out.write(bytes, sizeof(bytes));
+    }
+    if (_data_start.has_value()) {
+        const auto start   = _data_start.value();
+        const char bytes[] = {static_cast<char>(common::feature::data),
+                              static_cast<char>(start >> 56),
+                              static_cast<char>((start << 8) >> 56),
+                              static_cast<char>((start << 16) >> 56),
+                              static_cast<char>((start << 24) >> 56),
+                              static_cast<char>((start << 32) >> 56),
+                              static_cast<char>((start << 40) >> 56),
+                              static_cast<char>((start << 48) >> 56),
+                              static_cast<char>((start << 56) >> 56)};
+        _out.write(bytes, sizeof(bytes));
+    }
+    _out.write(";", 1);
+}
+
 auto assembler::emit(common::opcode op) -> void {
     LOG1(op);
     if (_has_errors) {
@@ -222,21 +527,8 @@ auto assembler::emit(common::opcode op, std::uint64_t num) -> void {
 
 auto assembler::emit(common::opcode op, std::string label) -> void {
     LOG2(op, label);
-    if (_labels.find(label) == _labels.end()) {
-        _labels[label].push_back(0);
-        _labels[label].push_back(_pc);
-        // Defer the rest of the work to the (opcode, uint64) overload
-        emit(op, 0);
-        return;
-    }
-    if (_labels[label][0] == 0) {
-        _labels[label].push_back(_pc);
-        // Defer the rest of the work to the (opcode, uint64) overload
-        emit(op, 0);
-        return;
-    }
     // Defer the rest of the work to the (opcode, uint64) overload
-    emit(op, _labels[label][0]);
+    emit(op, address_of(label, _pc + 1));
 }
 
 auto assembler::emit(common::opcode op,
@@ -252,6 +544,41 @@ auto assembler::emit(common::opcode op,
     _out.write(chars, 3);
 }
 
+auto assembler::emit(common::opcode op,
+                     common::registers reg,
+                     std::uint64_t num) -> void {
+    LOG2(op, reg);
+    LOG1(num);
+    if (_has_errors) {
+        return;
+    }
+    _pc += 10;
+    const char chars[] = {static_cast<char>(op), static_cast<char>(reg)};
+    _out.write(chars, sizeof(chars));
+    const char bytes[] = {static_cast<char>(num >> 56),
+                          static_cast<char>((num << 8) >> 56),
+                          static_cast<char>((num << 16) >> 56),
+                          static_cast<char>((num << 24) >> 56),
+                          static_cast<char>((num << 32) >> 56),
+                          static_cast<char>((num << 40) >> 56),
+                          static_cast<char>((num << 48) >> 56),
+                          static_cast<char>((num << 56) >> 56)};
+    _out.write(bytes, sizeof(bytes));
+}
+
+auto assembler::emit(common::opcode op,
+                     std::array<common::registers, 3> regs) -> void {
+    LOG1(op);
+    if (_has_errors) {
+        return;
+    }
+    _pc += 4;
+    const char chars[] = {static_cast<char>(op), static_cast<char>(regs[0]),
+                          static_cast<char>(regs[1]),
+                          static_cast<char>(regs[2])};
+    _out.write(chars, sizeof(chars));
+}
+
 auto assembler::emit(common::opcode op,
                      common::io_op subop,
                      common::registers reg) -> void {
@@ -264,26 +591,143 @@ auto assembler::emit(common::opcode op,
     _out.write(chars, sizeof(chars));
 }
 
+auto assembler::emit(common::opcode op,
+                     common::vec_op subop,
+                     std::pair<common::registers, common::registers> regs)
+    -> void {
+    if (_has_errors) {
+        return;
+    }
+    _pc += 4;
+    const char chars[] = {static_cast<char>(op), static_cast<char>(subop),
+                          static_cast<char>(regs.first),
+                          static_cast<char>(regs.second)};
+    _out.write(chars, sizeof(chars));
+}
+
+auto assembler::emit(common::opcode op,
+                     common::registers reg,
+                     std::string label) -> void {
+    LOG2(op, label);
+    // Defer the rest of the work to the (opcode, register, uint64) overload
+    emit(op, reg, address_of(label, _pc + 2));
+}
+
+auto assembler::emit(common::opcode op,
+                     common::registers reg,
+                     const std::vector<std::string>& labels) -> void {
+    LOG2(op, reg);
+    if (_has_errors) {
+        return;
+    }
+    // The targets follow the number of entries in the table
+    const std::uint64_t count = labels.size();
+
+    const char header[] = {static_cast<char>(op),
+                           static_cast<char>(reg),
+                           static_cast<char>(count >> 56),
+                           static_cast<char>((count << 8) >> 56),
+                           static_cast<char>((count << 16) >> 56),
+                           static_cast<char>((count << 24) >> 56),
+                           static_cast<char>((count << 32) >> 56),
+                           static_cast<char>((count << 40) >> 56),
+                           static_cast<char>((count << 48) >> 56),
+                           static_cast<char>((count << 56) >> 56)};
+    _out.write(header, sizeof(header));
+    _pc += sizeof(header);
+    for (const auto& label : labels) {
+        const auto address = address_of(label, _pc);
+        const char bytes[] = {static_cast<char>(address >> 56),
+                              static_cast<char>((address << 8) >> 56),
+                              static_cast<char>((address << 16) >> 56),
+                              static_cast<char>((address << 24) >> 56),
+                              static_cast<char>((address << 32) >> 56),
+                              static_cast<char>((address << 40) >> 56),
+                              static_cast<char>((address << 48) >> 56),
+                              static_cast<char>((address << 56) >> 56)};
+        _out.write(bytes, 8);
+        _pc += 8;
+    }
+}
+
+auto assembler::emit(common::opcode op,
+                     std::pair<common::registers, common::registers> regs,
+                     common::condition cond) -> void {
+    LOG1_NONL(op) /* << */ PAIR(regs);
+    LOG1(cond);
+    if (_has_errors) {
+        return;
+    }
+    _pc += 4;
+    const char chars[] = {static_cast<char>(op), static_cast<char>(regs.first),
+                          static_cast<char>(regs.second),
+                          static_cast<char>(cond)};
+    _out.write(chars, sizeof(chars));
+}
+
+auto assembler::emit(common::opcode op,
+                     std::array<common::registers, 3> regs,
+                     common::condition cond) -> void {
+    LOG2(op, cond);
+    if (_has_errors) {
+        return;
+    }
+    _pc += 5;
+    const char chars[] = {static_cast<char>(op), static_cast<char>(regs[0]),
+                          static_cast<char>(regs[1]),
+                          static_cast<char>(regs[2]),
+                          static_cast<char>(cond)};
+    _out.write(chars, sizeof(chars));
+}
+
+auto assembler::address_of(const std::string& label, std::uint64_t hole)
+    -> std::uint64_t {
+    auto& addresses = _labels[label];
+    if (addresses.empty()) {
+        addresses.push_back(0);
+    }
+    if (addresses[0] == 0) {
+        // Not defined yet, so the address gets written in the hole at the end
+        addresses.push_back(hole);
+    }
+    return addresses[0];
+}
+
 auto assembler::emit_remaining_labels() -> void {
+    if (_has_errors) {
+        return;
+    }
     for (const auto& vecs : _labels) {
-        if (vecs.second.size() > 1) {
-            auto address = vecs.second[0];
-            for (auto hole : vecs.second) {
-                _out.seekp(hole);
-                const char bytes[] = {static_cast<char>(address >> 56),
-                                      static_cast<char>((address << 8) >> 56),
-                                      static_cast<char>((address << 16) >> 56),
-                                      static_cast<char>((address << 24) >> 56),
-                                      static_cast<char>((address << 32) >> 56),
-                                      static_cast<char>((address << 40) >> 56),
-                                      static_cast<char>((address << 48) >> 56),
-                                      static_cast<char>((address << 56) >> 56)};
-                _out.write(bytes, 8);
-            }
+        auto address = vecs.second[0];
+        if (address == 0) {
+            report_to_user(level::error,
+                           "Label '" + vecs.first + "' is never defined.");
+            continue;
+        }
+        for (auto hole = vecs.second.begin() + 1; hole != vecs.second.end();
+             hole++) {
+            _out.seekp(*hole);
+            const char bytes[] = {static_cast<char>(address >> 56),
+                                  static_cast<char>((address << 8) >> 56),
+                                  static_cast<char>((address << 16) >> 56),
+                                  static_cast<char>((address << 24) >> 56),
+                                  static_cast<char>((address << 32) >> 56),
+                                  static_cast<char>((address << 40) >> 56),
+                                  static_cast<char>((address << 48) >> 56),
+                                  static_cast<char>((address << 56) >> 56)};
+            _out.write(bytes, 8);
         }
     }
 }
 
+auto assembler::emit_data(const std::string& bytes) -> void {
+    if (_has_errors) {
+        return;
+    }
+    _out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    _pc += bytes.size();
+}
+
 auto assembler::get_label(const std::string& line) -> std::string {
     LOG1(line);
     // TODO: reject code like .label    :
@@ -291,10 +735,18 @@ auto assembler::get_label(const std::string& line) -> std::string {
     return std::string {line.begin() + 1, line.begin() + label_end};
 }
 
+auto assembler::is_label_char(char c) noexcept -> bool {
+    return std::isalnum(static_cast<unsigned char>(c)) or c == '_';
+}
+
 auto assembler::get_opcode(const std::string& line) -> common::opcode {
     LOG1(line);
+    auto name_end = line.find_first_of(' ');
+    if (name_end == std::string::npos) {
+        name_end = line.size();
+    }
     auto instruction_name =
-        std::string {line.begin() + 1, line.begin() + line.find_first_of(' ')};
+        std::string {line.begin() + 1, line.begin() + name_end};
     auto op = magic_enum::enum_cast<common::opcode>(instruction_name);
     if (not op.has_value()) {
         report_to_user(level::error, instruction_name + " in line '" + line
@@ -312,12 +764,24 @@ auto assembler::get_category(common::opcode op) -> opcode_category {
     case opcode::halt:
         return opcode_category::nullary;
     case opcode::pushc:
+    case opcode::callnative:
+    case opcode::pushm:
+    case opcode::popm:
+    case opcode::enter:
+    case opcode::leave:
         return opcode_category::unary_constant;
     case opcode::not_:
     case opcode::pop:
     case opcode::push:
+    case opcode::insize:
+    case opcode::jmpr:
+    case opcode::callr:
+    case opcode::free:
+    case opcode::htnew:
+    case opcode::fclose:
         return opcode_category::unary_register;
     case opcode::call:
+    case opcode::tcall:
     case opcode::jmp:
     case opcode::jeq:
     case opcode::jneq:
@@ -337,9 +801,100 @@ auto assembler::get_category(common::opcode op) -> opcode_category {
     case opcode::lshft:
     case opcode::rshft:
     case opcode::cmp:
+    case opcode::mov:
+    case opcode::load8:
+    case opcode::load16:
+    case opcode::load32:
+    case opcode::load64:
+    case opcode::store8:
+    case opcode::store16:
+    case opcode::store32:
+    case opcode::store64:
+    case opcode::inload8:
+    case opcode::inload16:
+    case opcode::inload32:
+    case opcode::inload64:
+    case opcode::popcnt:
+    case opcode::clz:
+    case opcode::ctz:
+    case opcode::bswap:
+    case opcode::rotl:
+    case opcode::rotr:
+    case opcode::crc32:
+    case opcode::adc:
+    case opcode::sbb:
+    case opcode::fmov:
+    case opcode::fadd:
+    case opcode::fsub:
+    case opcode::fmul:
+    case opcode::fdiv:
+    case opcode::fsqrt:
+    case opcode::fcmp:
+    case opcode::cvtif:
+    case opcode::cvtfi:
+    case opcode::movif:
+    case opcode::movfi:
+    case opcode::alloc:
+    case opcode::htdel:
+    case opcode::sort:
+    case opcode::sortkv:
+    case opcode::dload8:
+    case opcode::dload16:
+    case opcode::dload32:
+    case opcode::dload64:
+    case opcode::fseek:
         return opcode_category::binary_registers;
+    case opcode::movi:
+    case opcode::addi:
+    case opcode::subi:
+    case opcode::muli:
+    case opcode::andi:
+    case opcode::ori:
+    case opcode::xori:
+    case opcode::shli:
+    case opcode::shri:
+    case opcode::cmpi:
+    case opcode::ldsp:
+    case opcode::stsp:
+    case opcode::fmovi:
+        return opcode_category::binary_register_then_constant;
+    case opcode::add3:
+    case opcode::sub3:
+    case opcode::mul3:
+    case opcode::div3:
+    case opcode::mod3:
+    case opcode::and3:
+    case opcode::or3:
+    case opcode::xor3:
+    case opcode::lshft3:
+    case opcode::rshft3:
+    case opcode::mcpy:
+    case opcode::mset:
+    case opcode::mcmp:
+    case opcode::mchr:
+    case opcode::mulx:
+    case opcode::divmod:
+    case opcode::fma:
+    case opcode::htput:
+    case opcode::htget:
+    case opcode::bsearch:
+    case opcode::dcpy:
+    case opcode::fopen:
+    case opcode::fread:
+    case opcode::fwrite:
+        return opcode_category::ternary_registers;
     case opcode::io:
         return opcode_category::binary_byte_then_register;
+    case opcode::vec:
+        return opcode_category::ternary_byte_then_registers;
+    case opcode::loop:
+        return opcode_category::register_then_label;
+    case opcode::jtab:
+        return opcode_category::register_then_labels;
+    case opcode::cmov:
+        return opcode_category::binary_registers_then_condition;
+    case opcode::csel:
+        return opcode_category::ternary_registers_then_condition;
         // default:
         // TOOD: internal assembler error maybe? assert it's not reached?
     }
@@ -395,6 +950,86 @@ auto assembler::get_register_pair(const std::string& line)
     return std::pair {r1.value(), r2.value()};
 }
 
+auto assembler::get_register_triple(const std::string& line)
+    -> std::optional<std::array<common::registers, 3>> {
+    LOG1(line);
+    std::array<common::registers, 3> regs;
+    auto reg_start = line.find_first_of(' ');
+    for (auto& reg : regs) {
+        while (reg_start < line.size() && not std::isalpha(line[reg_start])) {
+            reg_start++;
+        }
+        auto reg_end = reg_start;
+        while (std::isalnum(line[reg_end])) {
+            reg_end++;
+        }
+        auto the_register =
+            parse_register({line.begin() + reg_start, line.begin() + reg_end});
+        if (not the_register.has_value()) {
+            return {};
+        }
+        reg       = the_register.value();
+        reg_start = reg_end;
+    }
+    return regs;
+}
+
+auto assembler::get_register_and_constant(const std::string& line)
+    -> std::optional<std::pair<common::registers, std::uint64_t>> {
+    LOG1(line);
+    auto reg_start = line.find_first_of(' ');
+    while (not std::isalpha(line[reg_start])) {
+        reg_start++;
+    }
+    auto reg_end = reg_start;
+    while (std::isalnum(line[reg_end])) {
+        reg_end++;
+    }
+    auto the_register =
+        parse_register({line.begin() + reg_start, line.begin() + reg_end});
+    if (not the_register.has_value()) {
+        return {};
+    }
+    auto num_start = line.find_first_of(',', reg_end);
+    if (num_start == std::string::npos) {
+        report_to_user(level::error,
+                       "Missing constant operand in line '" + line + "'.");
+        return {};
+    }
+    // The constant is the rest of the line, optionally negated, in any base
+    // stoull understands with base 0 (decimal, 0x hex, 0 octal)
+    auto text  = line.substr(num_start + 1);
+    auto first = text.find_first_not_of(" \t");
+    auto last  = text.find_last_not_of(" \t");
+    auto bad_constant = [&] {
+        report_to_user(level::error, "The constant operand in line '" + line
+                                         + "' is not a valid number.");
+        return std::nullopt;
+    };
+    if (first == std::string::npos) {
+        return bad_constant();
+    }
+    text                = text.substr(first, last - first + 1);
+    const auto negative = text[0] == '-';
+    if (negative) {
+        text.erase(0, 1);
+    }
+    if (text.empty() or not std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return bad_constant();
+    }
+    std::uint64_t num;
+    std::size_t parsed;
+    try {
+        num = std::stoull(text, &parsed, 0);
+    } catch (const std::logic_error& e) {
+        return bad_constant();
+    }
+    if (parsed != text.size()) {
+        return bad_constant();
+    }
+    return std::pair {the_register.value(), negative ? 0 - num : num};
+}
+
 auto assembler::get_io_op_and_reg(const std::string& line)
     -> std::optional<std::pair<common::io_op, common::registers>> {
     LOG1(line);
@@ -408,10 +1043,9 @@ auto assembler::get_io_op_and_reg(const std::string& line)
     while (not std::isalpha(line[reg_start])) {
         reg_start++;
     }
-    reg_start += 4;
-    // put8c is the only IO operation to have 5 characters currently
-    // FIXME(?): more robust logic or nah?
-    reg_start += (the_io_op.value() == common::io_op::put8c);
+    while (std::isalnum(line[reg_start])) {
+        reg_start++;
+    }
     while (not std::isalpha(line[reg_start])) {
         reg_start++;
     }
@@ -448,6 +1082,33 @@ auto assembler::get_io_op(const std::string& line)
     return the_op.value();
 }
 
+auto assembler::get_vec_op_and_regs(const std::string& line)
+    -> std::optional<
+        std::pair<common::vec_op,
+                  std::pair<common::registers, common::registers>>> {
+    LOG1(line);
+    auto op_start = line.find_first_of(' ');
+    while (not std::isalpha(line[op_start])) {
+        op_start++;
+    }
+    auto op_end = op_start;
+    while (std::isalnum(line[op_end]) || line[op_end] == '_') {
+        op_end++;
+    }
+    auto op     = std::string {line.begin() + op_start, line.begin() + op_end};
+    auto the_op = magic_enum::enum_cast<common::vec_op>(op);
+    if (not the_op.has_value()) {
+        report_to_user(level::error, op + " in line '" + line
+                                         + "' is not a valid vector operation.");
+        return {};
+    }
+    auto regs = get_register_pair(line.substr(op_end));
+    if (not regs.has_value()) {
+        return {};
+    }
+    return std::pair {the_op.value(), regs.value()};
+}
+
 auto assembler::parse_register(const std::string& reg)
     -> std::optional<common::registers> {
     LOG1(reg);
@@ -460,6 +1121,94 @@ auto assembler::parse_register(const std::string& reg)
     return the_register.value();
 }
 
+auto assembler::get_condition(const std::string& line)
+    -> std::optional<common::condition> {
+    LOG1(line);
+    // The condition is always the last operand
+    auto cond_start = line.find_last_of(',');
+    if (cond_start == std::string::npos) {
+        report_to_user(level::error,
+                       "Missing condition in line '" + line + "'.");
+        return {};
+    }
+    while (cond_start < line.size() && not std::isalpha(line[cond_start])) {
+        cond_start++;
+    }
+    auto cond_end = cond_start;
+    while (cond_end < line.size() && std::isalpha(line[cond_end])) {
+        cond_end++;
+    }
+    auto cond =
+        std::string {line.begin() + cond_start, line.begin() + cond_end};
+    auto the_cond = magic_enum::enum_cast<common::condition>(cond);
+    if (not the_cond.has_value()) {
+        report_to_user(level::error, cond + " in line '" + line
+                                         + "' is not a valid condition.");
+    }
+    return the_cond;
+}
+
+auto assembler::get_register_and_label(const std::string& line)
+    -> std::optional<std::pair<common::registers, std::string>> {
+    LOG1(line);
+    auto reg_and_labels = get_register_and_labels(line);
+    if (not reg_and_labels.has_value()) {
+        return {};
+    }
+    if (reg_and_labels.value().second.size() != 1) {
+        report_to_user(level::error,
+                       "Expected a single label in line '" + line + "'.");
+        return {};
+    }
+    return std::pair {reg_and_labels.value().first,
+                      reg_and_labels.value().second[0]};
+}
+
+auto assembler::get_register_and_labels(const std::string& line)
+    -> std::optional<std::pair<common::registers, std::vector<std::string>>> {
+    LOG1(line);
+    auto reg_start = line.find_first_of(' ');
+    while (reg_start < line.size() && not std::isalpha(line[reg_start])) {
+        reg_start++;
+    }
+    auto reg_end = reg_start;
+    while (std::isalnum(line[reg_end])) {
+        reg_end++;
+    }
+    auto the_register =
+        parse_register({line.begin() + reg_start, line.begin() + reg_end});
+    if (not the_register.has_value()) {
+        return {};
+    }
+    std::vector<std::string> labels;
+    for (auto comma = line.find_first_of(',', reg_end);
+         comma != std::string::npos;
+         comma = line.find_first_of(',', comma + 1)) {
+        auto label_start = comma + 1;
+        while (label_start < line.size()
+               && not is_label_char(line[label_start])) {
+            label_start++;
+        }
+        auto label_end = label_start;
+        while (label_end < line.size() && is_label_char(line[label_end])) {
+            label_end++;
+        }
+        if (label_start == label_end) {
+            report_to_user(level::error,
+                           "Missing label in line '" + line + "'.");
+            return {};
+        }
+        labels.emplace_back(line.begin() + label_start,
+                            line.begin() + label_end);
+    }
+    if (labels.empty()) {
+        report_to_user(level::error,
+                       "Missing label in line '" + line + "'.");
+        return {};
+    }
+    return std::pair {the_register.value(), labels};
+}
+
 auto assembler::is_read_only(common::registers reg) noexcept -> bool {
     LOG1(reg);
     using common::registers;
@@ -27,6 +27,7 @@
 #include "../../common/opcodes.hpp"
 #include "../../common/registers.hpp"
 
+#include <array>
 #include <cstdint>
 #include <fstream>
 #include <optional>
@@ -50,6 +51,7 @@ public:
 
 private:
     static auto get_label(const std::string& line) -> std::string;
+    static auto is_label_char(char c) noexcept -> bool;
     static auto get_opcode(const std::string& line) -> common::opcode;
     static auto parse_register(const std::string& name)
         -> std::optional<common::registers>;
@@ -57,10 +59,25 @@ private:
         -> std::optional<common::registers>;
     static auto get_register_pair(const std::string& line)
         -> std::optional<std::pair<common::registers, common::registers>>;
+    static auto get_register_triple(const std::string& line)
+        -> std::optional<std::array<common::registers, 3>>;
+    static auto get_register_and_constant(const std::string& line)
+        -> std::optional<std::pair<common::registers, std::uint64_t>>;
     static auto get_io_op(const std::string& line)
         -> std::optional<common::io_op>;
     static auto get_io_op_and_reg(const std::string& line)
         -> std::optional<std::pair<common::io_op, common::registers>>;
+    static auto get_vec_op_and_regs(const std::string& line)
+        -> std::optional<
+            std::pair<common::vec_op,
+                      std::pair<common::registers, common::registers>>>;
+    static auto get_condition(const std::string& line)
+        -> std::optional<common::condition>;
+    static auto get_register_and_label(const std::string& line)
+        -> std::optional<std::pair<common::registers, std::string>>;
+    static auto get_register_and_labels(const std::string& line)
+        -> std::optional<
+            std::pair<common::registers, std::vector<std::string>>>;
     static auto is_read_only(common::registers reg) noexcept -> bool;
 
     enum class opcode_category {
@@ -69,25 +86,62 @@ private:
         unary_label,
         unary_constant,
         binary_registers,
+        binary_register_then_constant,
+        ternary_registers,
         binary_byte_then_register,
+        ternary_byte_then_registers,
+        register_then_label,
+        register_then_labels,
+        binary_registers_then_condition,
+        ternary_registers_then_condition,
     };
     static auto get_category(common::opcode op) -> opcode_category;
 
+    auto handle_directive(const std::string& line) -> void;
     auto write_preamble() -> void;
+    auto write_features() -> void;
     auto emit(common::opcode op) -> void;
     auto emit(common::opcode op, std::string label) -> void;
     auto emit(common::opcode op, common::registers reg) -> void;
     auto emit(common::opcode op, std::uint64_t num) -> void;
     auto emit(common::opcode op,
               std::pair<common::registers, common::registers> regs) -> void;
+    auto emit(common::opcode op, common::registers reg, std::uint64_t num)
+        -> void;
+    auto emit(common::opcode op, std::array<common::registers, 3> regs)
+        -> void;
     auto emit(common::opcode op, common::io_op subop, common::registers reg)
         -> void;
+    auto emit(common::opcode op,
+              common::vec_op subop,
+              std::pair<common::registers, common::registers> regs) -> void;
+    auto emit(common::opcode op, common::registers reg, std::string label)
+        -> void;
+    auto emit(common::opcode op,
+              common::registers reg,
+              const std::vector<std::string>& labels) -> void;
+    auto emit(common::opcode op,
+              std::pair<common::registers, common::registers> regs,
+              common::condition cond) -> void;
+    auto emit(common::opcode op,
+              std::array<common::registers, 3> regs,
+              common::condition cond) -> void;
+    // Returns the address of `label`, or 0 if it is not defined yet, in which
+    // case emit_remaining_labels() writes it at `hole` in the output
+    auto address_of(const std::string& label, std::uint64_t hole)
+        -> std::uint64_t;
     auto emit_remaining_labels() -> void;
+    // Appends raw bytes to the data section
+    auto emit_data(const std::string& bytes) -> void;
 
     std::ifstream _file;
     std::ofstream _out;
     std::string _output_name;
     std::unordered_map<std::string, std::vector<std::uint64_t>> _labels;
+    std::optional<std::uint64_t> _memory_size;
+    std::optional<std::uint64_t> _heap_base;
+    // Where the data section starts, once `.data` has been seen
+    std::optional<std::uint64_t> _data_start;
     std::uint64_t _pc {256};
     bool _has_errors {false};
 };
@@ -47,10 +47,18 @@ enum class opcode : unsigned char {
     lshft = 29,
     rshft = 30,
 
+    // Stack frames
+    ldsp  = 31,
+    stsp  = 32,
+    enter = 33,
+    leave = 34,
+
     // Stack operations
     push  = 35,
     pushc = 36,
     pop   = 37,
+    pushm = 38,
+    popm  = 39,
 
     // Branching
     cmp  = 42,
@@ -62,14 +70,207 @@ enum class opcode : unsigned char {
     jg   = 48,
     jgeq = 49,
 
+    // Register moves and immediate operands
+    mov  = 50,
+    movi = 51,
+    addi = 52,
+    subi = 53,
+    muli = 54,
+    andi = 55,
+    ori  = 56,
+    xori = 57,
+    shli = 58,
+    shri = 59,
+    cmpi = 60,
+
+    // Three operand integer arithmetics
+    add3   = 61,
+    sub3   = 62,
+    mul3   = 63,
+    div3   = 64,
+    mod3   = 65,
+    and3   = 66,
+    or3    = 67,
+    xor3   = 68,
+    lshft3 = 69,
+    rshft3 = 70,
+
+    // Linear memory operations
+    load8   = 71,
+    load16  = 72,
+    load32  = 73,
+    load64  = 74,
+    store8  = 75,
+    store16 = 76,
+    store32 = 77,
+    store64 = 78,
+
+    // Mapped input operations
+    insize   = 79,
+    inload8  = 80,
+    inload16 = 81,
+    inload32 = 82,
+    inload64 = 83,
+
+    // Metainstruction
+    vec = 84,
+
+    // Bulk memory operations
+    mcpy = 85,
+    mset = 86,
+    mcmp = 87,
+    mchr = 88,
+
+    // Bit manipulation and hashing
+    popcnt = 89,
+    clz    = 90,
+    ctz    = 91,
+    bswap  = 92,
+    rotl   = 93,
+    rotr   = 94,
+    crc32  = 95,
+
+    // Multi-precision arithmetic
+    adc    = 96,
+    sbb    = 97,
+    mulx   = 98,
+    divmod = 99,
+
+    // Host function interface
+    callnative = 100,
+
+    // Indirect branching
+    jmpr  = 101,
+    callr = 102,
+    jtab  = 103,
+
+    // Conditional moves
+    cmov = 104,
+    csel = 105,
+
+    // Counted loops
+    loop = 106,
+
+    // Tail calls
+    tcall = 107,
+
+    // Floating point operations
+    fmov  = 108,
+    fmovi = 109,
+    fadd  = 110,
+    fsub  = 111,
+    fmul  = 112,
+    fdiv  = 113,
+    fsqrt = 114,
+    fma   = 115,
+    fcmp  = 116,
+    cvtif = 117,
+    cvtfi = 118,
+    movif = 119,
+    movfi = 120,
+
+    // Heap allocation
+    alloc = 121,
+    free  = 122,
+
+    // Hash tables
+    htnew = 123,
+    htput = 124,
+    htget = 125,
+    htdel = 126,
+
+    // Sorting and searching the linear memory
+    sort    = 127,
+    sortkv  = 128,
+    bsearch = 129,
+
+    // Loads from the read-only data section
+    dload8  = 130,
+    dload16 = 131,
+    dload32 = 132,
+    dload64 = 133,
+    dcpy    = 134,
+
+    // Files
+    fopen  = 135,
+    fread  = 136,
+    fwrite = 137,
+    fseek  = 138,
+    fclose = 139,
+
     halt = 255,
 };
 
 enum class io_op : unsigned char {
-    getc  = 1,
-    putc  = 2,
-    put8c = 3,
-    putn  = 4,
+    getc   = 1,
+    putc   = 2,
+    put8c  = 3,
+    putn   = 4,
+    putf   = 5,
+    getf   = 6,
+    getn   = 7,
+    putns  = 8,
+    setsep = 9,
+    putm   = 10,
+};
+
+// The conditions `cmov` and `csel` can test the comparison flag for. Each is a
+// mask of the values of the flag it holds for: bit 0 for eq, bit 1 for less,
+// bit 2 for gr and bit 3 for unordered
+enum class condition : unsigned char {
+    eq  = 0b0001,
+    neq = 0b1110,
+    l   = 0b0010,
+    leq = 0b0011,
+    g   = 0b0100,
+    geq = 0b0101,
+};
+
+// The lower 2 bits of the lane-wise operations select the width of the lanes:
+// 8, 16, 32 or 64 bits
+enum class vec_op : unsigned char {
+    add8    = 0x10,
+    add16   = 0x11,
+    add32   = 0x12,
+    add64   = 0x13,
+    sub8    = 0x14,
+    sub16   = 0x15,
+    sub32   = 0x16,
+    sub64   = 0x17,
+    mul8    = 0x18,
+    mul16   = 0x19,
+    mul32   = 0x1a,
+    mul64   = 0x1b,
+    shl8    = 0x1c,
+    shl16   = 0x1d,
+    shl32   = 0x1e,
+    shl64   = 0x1f,
+    shr8    = 0x20,
+    shr16   = 0x21,
+    shr32   = 0x22,
+    shr64   = 0x23,
+    cmpeq8  = 0x24,
+    cmpeq16 = 0x25,
+    cmpeq32 = 0x26,
+    cmpeq64 = 0x27,
+    cmpgt8  = 0x28,
+    cmpgt16 = 0x29,
+    cmpgt32 = 0x2a,
+    cmpgt64 = 0x2b,
+    bcast8  = 0x2c,
+    bcast16 = 0x2d,
+    bcast32 = 0x2e,
+    bcast64 = 0x2f,
+    hsum8   = 0x30,
+    hsum16  = 0x31,
+    hsum32  = 0x32,
+    hsum64  = 0x33,
+
+    and_  = 0x40,
+    or_   = 0x41,
+    xor_  = 0x42,
+    load  = 0x50,
+    store = 0x51,
 };
 
 }   // namespace common
@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace common {
 
 // Valid reqvm binaries must start with this string,
@@ -36,9 +38,21 @@ static constexpr char magic_byte_string[] =
 namespace version {
 
 static constexpr std::uint16_t major = 0;
-static constexpr std::uint16_t minor = 1;
-static constexpr std::uint16_t patch = 5;
+static constexpr std::uint16_t minor = 2;
+static constexpr std::uint16_t patch = 0;
 
 }   // namespace version
 
+// Optional features, enabled by their byte being present in the features
+// string of the preamble
+enum class feature : std::uint8_t {
+    // Followed by the size of the linear memory in bytes, as 8 bytes
+    memory = 1,
+    // Followed by the address the heap starts at, as 8 bytes
+    heap = 2,
+    // Followed by the offset in the binary the read-only data section starts
+    // at, as 8 bytes. The section extends to the end of the binary
+    data = 3,
+};
+
 }   // namespace common
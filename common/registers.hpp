@@ -117,7 +117,43 @@ enum class registers : std::uint8_t {
     ifa12 = 144,
     ifa13 = 145,
     ifa14 = 146,
-    ifa15 = 147
+    ifa15 = 147,
+
+    // vector registers
+    v00 = 160,
+    v01 = 161,
+    v02 = 162,
+    v03 = 163,
+    v04 = 164,
+    v05 = 165,
+    v06 = 166,
+    v07 = 167,
+    v08 = 168,
+    v09 = 169,
+    v10 = 170,
+    v11 = 171,
+    v12 = 172,
+    v13 = 173,
+    v14 = 174,
+    v15 = 175,
+
+    // floating point registers
+    fp00 = 176,
+    fp01 = 177,
+    fp02 = 178,
+    fp03 = 179,
+    fp04 = 180,
+    fp05 = 181,
+    fp06 = 182,
+    fp07 = 183,
+    fp08 = 184,
+    fp09 = 185,
+    fp10 = 186,
+    fp11 = 187,
+    fp12 = 188,
+    fp13 = 189,
+    fp14 = 190,
+    fp15 = 191
 };
 
 constexpr bool operator==(registers lhs, registers rhs) noexcept {
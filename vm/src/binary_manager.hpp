@@ -53,6 +53,9 @@ public:
     virtual auto operator[](std::size_t idx) noexcept -> std::uint8_t = 0;
 
     virtual auto size() noexcept -> std::size_t = 0;
+
+    // The bytes of the binary, which are contiguous for every manager
+    virtual auto data() const noexcept -> const std::uint8_t* = 0;
 };
 
 auto load_from(const fs::path&) -> std::unique_ptr<binary_manager>;
@@ -46,6 +46,10 @@ public:
 
     auto size() noexcept -> std::size_t override;
 
+    auto data() const noexcept -> const std::uint8_t* override {
+        return _data;
+    }
+
 private:
 #if defined(REQVM_ON_WINDOWS)
     // We use this instead of ::HANDLE to avoid including <windows.h> here
@@ -60,6 +64,7 @@ private:
      *       * On MS Windows this is a view into the mapping
      *       * On POSIX platforms this is both the view and the handle to the
      *       mapping
+     *       * Empty files are not mapped, and this is null for them
      */
     std::uint8_t* _data;
 
@@ -82,13 +82,20 @@ mmf_backed_binary_manager::mmf_backed_binary_manager(const fs::path& path) {
         _size = static_cast<std::size_t>(st.st_size);
     }
 
+    if (_size == 0) {
+        // mmap refuses to map empty files, and there's nothing to map anyway
+        _data = nullptr;
+        IGNORE_RETURN(::close(fd));
+        return;
+    }
+
     _data = static_cast<std::uint8_t*>(
         ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0));
     if (_data == static_cast<std::uint8_t*>(MAP_FAILED)) {
         auto old_errno = errno;
         // See previous disclaimer on ::close()
         IGNORE_RETURN(::close(fd));
-        throw mmap_error {errno, mmap_error::kind::mapping};
+        throw mmap_error {old_errno, mmap_error::kind::mapping};
     }
 
     /*
@@ -113,7 +120,9 @@ mmf_backed_binary_manager::mmf_backed_binary_manager(const fs::path& path) {
 
 mmf_backed_binary_manager::~mmf_backed_binary_manager() {
     // Unmapping can fail, how (if we should) handle that?
-    ::munmap(_data, _size);
+    if (_data) {
+        ::munmap(_data, _size);
+    }
 }
 
 mmap_error::mmap_error(error_code_t ec, kind k) noexcept : _ec {ec}, _k {k} {}
@@ -128,7 +137,7 @@ auto mmap_error::what() const noexcept -> const char* {
     // way to make sense of them.
     switch (_k) {
     case kind::file: {
-#define PREFIX "An error occured while trying to open the binary:"
+#define PREFIX "An error occured while trying to open the file: "
         switch (_ec) {
             // clang-format off
         // Note: this doesn't check all error codes from open
@@ -138,7 +147,7 @@ auto mmap_error::what() const noexcept -> const char* {
         CASE(EACCES, "Access to the file not allowed, or search permission "
                      "denied for one of the directories in the path.")
         CASE(ELOOP, "Too many symbolic links were encountered while "
-                    "trying to resolve the path of the binary.")
+                    "trying to resolve the path of the file.")
         CASE(ENAMETOOLONG, "The path was too long.")
         CASE(ENFILE, "The system-wide limit on the total number of open "
                      "files was reached.")
@@ -158,7 +167,7 @@ auto mmap_error::what() const noexcept -> const char* {
     }
     case kind::file_size: {
 #define PREFIX                                                                 \
-    "An error occured while trying to obtain the size of the binary: "
+    "An error occured while trying to obtain the size of the file: "
         switch (_ec) {
             // clang-format off
         // Note: See previous note, same things apply
@@ -170,19 +179,19 @@ auto mmap_error::what() const noexcept -> const char* {
             // clang-format on
         default:
             return "An unknown error occured while trying to obtain the size "
-                   "of the binary.";
+                   "of the file.";
         }
 #undef PREFIX
     }
     case kind::mapping: {
-#define PREFIX "An error occured while trying to memory map the binary: "
+#define PREFIX "An error occured while trying to memory map the file: "
         switch (_ec) {
             // clang-format off
         CASE(EACCES, "The file descriptor referring to your file is nonregular")
         CASE(ENFILE, "The system-wide limit on the total number of open "
                      "files was reached.")
         CASE(ENOMEM, "No memory is available") // Can this happen in our situation ???
-        CASE(ENODEV, "The filesystem on which your binary resides does not"
+        CASE(ENODEV, "The filesystem on which your file resides does not"
                      " support memory mapping.")
         CASE(EINVAL, "Either your file was zero-sized (this indicates a bug in "
                      "reqvm as this code path is not supposed to be reached "
@@ -193,7 +202,7 @@ auto mmap_error::what() const noexcept -> const char* {
 
         default:
             return "An unknown error occured while trying to memory map the "
-                   "binary.";
+                   "file.";
         }
 #undef PREFIX
     }
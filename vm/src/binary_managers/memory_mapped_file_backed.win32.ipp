@@ -108,6 +108,13 @@ mmf_backed_binary_manager::mmf_backed_binary_manager(const fs::path& path) {
         _size = static_cast<std::size_t>(sz.QuadPart);
     }
 
+    if (_size == 0) {
+        // Empty files can't be mapped, and there's nothing to map anyway
+        _mapping = nullptr;
+        _data    = nullptr;
+        return;
+    }
+
     _mapping =
         ::CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
     if (not _mapping) {
@@ -126,8 +133,10 @@ mmf_backed_binary_manager::~mmf_backed_binary_manager() noexcept {
     // that. TODO: find a way
     // Though this destructor only gets called when the VM is shutting down.
     // So is failing really an issue? Win32 API Gods help me plz.
-    ::UnmapViewOfFile(_data);
-    ::CloseHandle(_mapping);
+    if (_data) {
+        ::UnmapViewOfFile(_data);
+        ::CloseHandle(_mapping);
+    }
     ::CloseHandle(_file);
 }
 
@@ -180,14 +189,14 @@ mmap_error::mmap_error(error_code_t ec, kind k) noexcept {
     const char* fmt_string {nullptr};
     switch (k) {
     case kind::file:
-        fmt_string = "An error occured while opening the binary: %s";
+        fmt_string = "An error occured while opening the file: %s";
         break;
     case kind::file_size:
         fmt_string =
-            "An error occured while calculating the size of your binary: %s";
+            "An error occured while calculating the size of your file: %s";
         break;
     case kind::mapping:
-        fmt_string = "An error occured while memory mapping the binary: %s";
+        fmt_string = "An error occured while memory mapping the file: %s";
         break;
     }
 
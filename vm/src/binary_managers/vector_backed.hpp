@@ -45,6 +45,10 @@ public:
 
     auto size() noexcept -> std::size_t override;
 
+    auto data() const noexcept -> const std::uint8_t* override {
+        return _binary.data();
+    }
+
 private:
     std::vector<std::uint8_t> _binary;
 };
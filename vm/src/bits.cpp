@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bits.hpp"
+
+#include <array>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#    define REQVM_HAS_SSE42_CRC32 1
+#    include <nmmintrin.h>
+#endif
+
+namespace reqvm {
+namespace bits {
+
+static constexpr auto make_crc32c_table() noexcept
+    -> std::array<std::uint32_t, 256> {
+    std::array<std::uint32_t, 256> table {};
+    for (std::uint32_t i = 0; i < 256; i++) {
+        auto crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr auto crc32c_table = make_crc32c_table();
+
+static auto table_crc32c(std::uint32_t crc, std::uint64_t val) noexcept
+    -> std::uint32_t {
+    for (int i = 0; i < 8; i++, val >>= 8) {
+        crc = crc32c_table[(crc ^ val) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(REQVM_HAS_SSE42_CRC32)
+__attribute__((target("sse4.2"))) static auto
+sse42_crc32c(std::uint32_t crc, std::uint64_t val) noexcept -> std::uint32_t {
+    return static_cast<std::uint32_t>(_mm_crc32_u64(crc, val));
+}
+#endif
+
+auto select_crc32c() noexcept -> crc32c_kernel {
+#if defined(REQVM_HAS_SSE42_CRC32)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return sse42_crc32c;
+    }
+#endif
+    return table_crc32c;
+}
+
+}   // namespace bits
+}   // namespace reqvm
@@ -0,0 +1,155 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+namespace reqvm {
+namespace bits {
+
+/*
+ * Bit manipulation helpers, on top of the compiler builtins where there are
+ * any. We build for the baseline of the host architecture, so on x86-64 the
+ * leading and trailing zero counts use bsr and bsf behind a test for 0, and
+ * popcount is a call into the compiler runtime; popcnt, lzcnt and tzcnt
+ * need -mpopcnt, -mlzcnt and -mbmi, which we do not pass.
+ */
+
+inline auto popcount(std::uint64_t val) noexcept -> std::uint64_t {
+#if defined(__GNUC__)
+    return static_cast<std::uint64_t>(__builtin_popcountll(val));
+#else
+    std::uint64_t count {0};
+    for (; val; val &= val - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Unlike the builtins, these are defined for 0, and return 64
+inline auto count_leading_zeros(std::uint64_t val) noexcept -> std::uint64_t {
+    if (val == 0) {
+        return 64;
+    }
+#if defined(__GNUC__)
+    return static_cast<std::uint64_t>(__builtin_clzll(val));
+#else
+    std::uint64_t count {0};
+    for (; not(val & (std::uint64_t {1} << 63)); val <<= 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+inline auto count_trailing_zeros(std::uint64_t val) noexcept -> std::uint64_t {
+    if (val == 0) {
+        return 64;
+    }
+#if defined(__GNUC__)
+    return static_cast<std::uint64_t>(__builtin_ctzll(val));
+#else
+    std::uint64_t count {0};
+    for (; not(val & 1); val >>= 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+inline auto byte_swap(std::uint64_t val) noexcept -> std::uint64_t {
+#if defined(__GNUC__)
+    return __builtin_bswap64(val);
+#else
+    std::uint64_t swapped {0};
+    for (int i = 0; i < 8; i++, val >>= 8) {
+        swapped = swapped << 8 | (val & 0xff);
+    }
+    return swapped;
+#endif
+}
+
+inline auto rotate_left(std::uint64_t val, std::uint64_t count) noexcept
+    -> std::uint64_t {
+    count &= 63;
+    return (val << count) | (val >> ((64 - count) & 63));
+}
+
+inline auto rotate_right(std::uint64_t val, std::uint64_t count) noexcept
+    -> std::uint64_t {
+    count &= 63;
+    return (val >> count) | (val << ((64 - count) & 63));
+}
+
+// These return the result and the carry (or borrow) out
+inline auto add_with_carry(std::uint64_t lhs, std::uint64_t rhs,
+                           bool carry) noexcept -> std::pair<std::uint64_t, bool> {
+    auto sum = lhs + rhs;
+    auto out = sum < lhs;
+    sum += carry;
+    return {sum, out or (carry and sum == 0)};
+}
+
+inline auto sub_with_borrow(std::uint64_t lhs, std::uint64_t rhs,
+                            bool borrow) noexcept
+    -> std::pair<std::uint64_t, bool> {
+    auto diff = lhs - rhs;
+    auto out  = lhs < rhs;
+    return {diff - borrow, out or (borrow and diff == 0)};
+}
+
+// Returns the high and low halves of the 128-bit product
+inline auto multiply_wide(std::uint64_t lhs, std::uint64_t rhs) noexcept
+    -> std::pair<std::uint64_t, std::uint64_t> {
+#if defined(__SIZEOF_INT128__)
+    auto product = static_cast<unsigned __int128>(lhs) * rhs;
+    return {static_cast<std::uint64_t>(product >> 64),
+            static_cast<std::uint64_t>(product)};
+#else
+    auto lo_lo = (lhs & 0xffffffff) * (rhs & 0xffffffff);
+    auto hi_lo = (lhs >> 32) * (rhs & 0xffffffff);
+    auto lo_hi = (lhs & 0xffffffff) * (rhs >> 32);
+    auto hi_hi = (lhs >> 32) * (rhs >> 32);
+    auto cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return {hi_hi + (hi_lo >> 32) + (cross >> 32),
+            (cross << 32) | (lo_lo & 0xffffffff)};
+#endif
+}
+
+/*
+ * Updates a CRC-32C (Castagnoli) with the 8 bytes of `val`, in little endian
+ * order. Like the SSE4.2 crc32 instruction, it does not invert the CRC before
+ * or after the update.
+ */
+using crc32c_kernel = auto (*)(std::uint32_t crc, std::uint64_t val) noexcept
+                      -> std::uint32_t;
+
+// Picks the SSE4.2 implementation if the host CPU supports it
+auto select_crc32c() noexcept -> crc32c_kernel;
+
+}   // namespace bits
+}   // namespace reqvm
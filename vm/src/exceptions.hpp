@@ -123,6 +123,9 @@ public:
         nonstandard_mbs,
         bad_version_serialization,
         unknown_feature,
+        bad_memory_size,
+        bad_heap_base,
+        bad_data_section,
     };
     explicit preamble_error(kind k) : _kind {k} {}
     virtual ~preamble_error() noexcept = default;
@@ -142,6 +145,22 @@ public:
                    "the preamble is badly serialised/nonstandard and as such "
                    "it is not possible to verify instruction set "
                    "compatibility.";
+        case kind::unknown_feature:
+            return "reqvm was unable to start because the preamble enables a "
+                   "feature it does not know about, or is cut short in the "
+                   "middle of the arguments of a feature.";
+        case kind::bad_memory_size:
+            return "reqvm was unable to start because the size of the linear "
+                   "memory requested in the preamble is larger than 4GiB or "
+                   "is not a multiple of 64KiB.";
+        case kind::bad_heap_base:
+            return "reqvm was unable to start because the heap base requested "
+                   "in the preamble is zero, past the end of the linear "
+                   "memory, or is not a multiple of 64KiB.";
+        case kind::bad_data_section:
+            return "reqvm was unable to start because the data section "
+                   "declared in the preamble starts inside the preamble or "
+                   "past the end of the binary.";
         default:
             return "Unknown preamble error. This is likely an internal VM bug.";
         }
@@ -0,0 +1,168 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "files.hpp"
+
+#include "binary_managers/exceptions.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <system_error>
+
+namespace reqvm {
+
+file_table::file::~file() noexcept {
+    if (stream) {
+        std::fclose(stream);
+    }
+}
+
+auto file_table::sandbox(const std::filesystem::path& root) -> void {
+    _sandbox = std::filesystem::weakly_canonical(root);
+}
+
+auto file_table::is_in_sandbox(const std::filesystem::path& path) const
+    -> bool {
+    if (not _sandbox.has_value()) {
+        return true;
+    }
+    std::error_code ec;
+    auto resolved = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+        return false;
+    }
+    auto relative = resolved.lexically_relative(_sandbox.value());
+    return not relative.empty() && *relative.begin() != "..";
+}
+
+auto file_table::open(std::string path, std::uint64_t the_mode)
+    -> std::optional<std::uint64_t> {
+    // The OS would stop at a NUL anyway, and the sandbox must check the same
+    // path the OS opens
+    path.erase(std::min(path.find('\0'), path.size()));
+    if (the_mode > static_cast<std::uint64_t>(mode::append)) {
+        throw bad_argument {"The binary has tried to open a file in mode "
+                            + std::to_string(the_mode)
+                            + ", which does not exist."};
+    }
+    if (not is_in_sandbox(path)) {
+        throw bad_argument {"The binary has tried to open '" + path
+                            + "', which is outside of the sandbox."};
+    }
+    auto opened      = std::make_unique<file>();
+    opened->the_mode = static_cast<mode>(the_mode);
+    if (opened->the_mode == mode::read) {
+        try {
+            opened->mapping = std::make_unique<mmf_backed_binary_manager>(
+                std::filesystem::path {path});
+        } catch (const mmap_error&) {
+            return {};
+        } catch (const std::filesystem::filesystem_error&) {
+            return {};
+        }
+    } else {
+        opened->stream = std::fopen(
+            path.c_str(), opened->the_mode == mode::write ? "wb" : "ab");
+        if (not opened->stream) {
+            return {};
+        }
+        opened->buffer = std::make_unique<char[]>(write_buffer_size);
+        std::setvbuf(opened->stream, opened->buffer.get(), _IOFBF,
+                     write_buffer_size);
+    }
+    auto slot = std::find(_files.begin(), _files.end(), nullptr);
+    if (slot == _files.end()) {
+        _files.push_back(std::move(opened));
+        return _files.size() - 1;
+    }
+    *slot = std::move(opened);
+    return static_cast<std::uint64_t>(slot - _files.begin());
+}
+
+auto file_table::at(std::uint64_t handle) -> file& {
+    if (handle >= _files.size() || not _files[handle]) {
+        throw bad_argument {"The binary has tried to use file handle "
+                            + std::to_string(handle)
+                            + ", which is not open."};
+    }
+    return *_files[handle];
+}
+
+auto file_table::read(std::uint64_t handle,
+                      memory& mem,
+                      std::uint64_t address,
+                      std::uint64_t count) -> std::uint64_t {
+    auto& the_file = at(handle);
+    if (the_file.the_mode != mode::read) {
+        throw bad_argument {"The binary has tried to read from file handle "
+                            + std::to_string(handle)
+                            + ", which is not open for reading."};
+    }
+    auto size = the_file.mapping->size();
+    count     = the_file.position < size
+                    ? std::min(count, size - the_file.position)
+                    : 0;
+    if (count != 0) {
+        mem.copy_in(address, the_file.mapping->data() + the_file.position,
+                    count);
+    }
+    the_file.position += count;
+    return count;
+}
+
+auto file_table::write(std::uint64_t handle,
+                       const std::uint8_t* bytes,
+                       std::uint64_t count) -> std::uint64_t {
+    auto& the_file = at(handle);
+    if (the_file.the_mode == mode::read) {
+        throw bad_argument {"The binary has tried to write to file handle "
+                            + std::to_string(handle)
+                            + ", which is not open for writing."};
+    }
+    return std::fwrite(bytes, 1, count, the_file.stream);
+}
+
+auto file_table::seek(std::uint64_t handle, std::uint64_t position) -> bool {
+    auto& the_file = at(handle);
+    // fseek takes a long, the same limit applies to mapped files for
+    // consistency
+    if (position > static_cast<std::uint64_t>(LONG_MAX)) {
+        return false;
+    }
+    if (the_file.the_mode == mode::read) {
+        the_file.position = position;
+        return true;
+    }
+    // Appending always writes at the end, whatever the position
+    return std::fseek(the_file.stream, static_cast<long>(position), SEEK_SET)
+           == 0;
+}
+
+auto file_table::close(std::uint64_t handle) -> void {
+    at(handle);
+    _files[handle].reset();
+}
+
+}   // namespace reqvm
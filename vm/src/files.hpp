@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "binary_managers/memory_mapped_file_backed.hpp"
+#include "memory.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace reqvm {
+
+/*
+ * The files the binary has opened with `fopen`, indexed by their handles.
+ *
+ * Files opened for reading are memory mapped, so reads are a copy from the
+ * mapping into the linear memory. Files opened for writing go through a large
+ * stdio buffer, so small writes rarely reach the OS.
+ *
+ * When sandboxed, only paths inside the sandbox directory can be opened, after
+ * resolving `..` and symbolic links.
+ */
+class file_table final {
+public:
+    enum class mode : std::uint8_t {
+        read   = 0,
+        write  = 1,
+        append = 2,
+    };
+
+    static constexpr std::size_t write_buffer_size = 1024 * 1024;
+    // What fopen stores instead of a handle when the file cannot be opened, 0
+    // being a valid handle
+    static constexpr std::uint64_t no_handle = ~std::uint64_t {0};
+
+    auto sandbox(const std::filesystem::path& root) -> void;
+
+    // Returns the handle of the opened file, or nothing if the OS could not
+    // open it. The path ends at its first NUL byte, if any
+    auto open(std::string path, std::uint64_t the_mode)
+        -> std::optional<std::uint64_t>;
+    // Returns how many bytes were read, which is less than `count` at the end
+    // of the file
+    auto read(std::uint64_t handle,
+              memory& mem,
+              std::uint64_t address,
+              std::uint64_t count) -> std::uint64_t;
+    // Returns how many bytes were written, which is less than `count` if the
+    // OS reported an error
+    auto write(std::uint64_t handle,
+               const std::uint8_t* bytes,
+               std::uint64_t count) -> std::uint64_t;
+    // Returns false if the position is past what the host can seek to, or the
+    // OS reported an error
+    auto seek(std::uint64_t handle, std::uint64_t position) -> bool;
+    auto close(std::uint64_t handle) -> void;
+
+private:
+    struct file {
+        mode the_mode;
+        // Set for files opened for reading
+        std::unique_ptr<mmf_backed_binary_manager> mapping;
+        std::uint64_t position {0};
+        // Set for files opened for writing or appending
+        std::FILE* stream {nullptr};
+        std::unique_ptr<char[]> buffer;
+
+        ~file() noexcept;
+    };
+
+    auto at(std::uint64_t handle) -> file&;
+    auto is_in_sandbox(const std::filesystem::path& path) const -> bool;
+
+    std::optional<std::filesystem::path> _sandbox;
+    // Closed files leave a null behind, which the next open reuses
+    std::vector<std::unique_ptr<file>> _files;
+};
+
+}   // namespace reqvm
@@ -30,13 +30,15 @@ namespace reqvm {
 
 struct flags {
     enum class cf {
-        eq   = 0b0000'0000,
-        less = 0b0000'0001,
-        gr   = 0b0000'0010,
+        eq        = 0b0000'0000,
+        less      = 0b0000'0001,
+        gr        = 0b0000'0010,
+        unordered = 0b0000'0011,   // set by fcmp when an operand is NaN
     };
 
     std::uint64_t cmp_flag : 2;
-    std::uint64_t reserved : 62;
+    std::uint64_t carry_flag : 1;
+    std::uint64_t reserved : 61;
 };
 
 }   // namespace reqvm
@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "fp.hpp"
+
+#include <cmath>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#    define REQVM_HAS_FMA3 1
+#endif
+
+namespace reqvm {
+namespace fp {
+
+// Without FMA3 this is done in software by the C library, slowly but exactly
+static auto library_fma(double a, double b, double c) noexcept -> double {
+    return std::fma(a, b, c);
+}
+
+#if defined(REQVM_HAS_FMA3)
+__attribute__((target("fma"))) static auto
+fma3_fma(double a, double b, double c) noexcept -> double {
+    return __builtin_fma(a, b, c);
+}
+#endif
+
+auto select_fma() noexcept -> fma_kernel {
+#if defined(REQVM_HAS_FMA3)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("fma")) {
+        return fma3_fma;
+    }
+#endif
+    return library_fma;
+}
+
+}   // namespace fp
+}   // namespace reqvm
@@ -0,0 +1,56 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace reqvm {
+namespace fp {
+
+/*
+ * Truncates `val` towards zero. Like the SSE2 cvttsd2si instruction, NaNs and
+ * values which do not fit in 64 bits give the "integer indefinite" value,
+ * INT64_MIN.
+ */
+inline auto to_integer(double val) noexcept -> std::uint64_t {
+    constexpr auto limit = 9223372036854775808.0;   // 2^63
+    if (not(val >= -limit && val < limit)) {
+        return std::uint64_t {1} << 63;
+    }
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(val));
+}
+
+inline auto from_integer(std::uint64_t val) noexcept -> double {
+    return static_cast<double>(static_cast<std::int64_t>(val));
+}
+
+// Computes `a * b + c` with a single rounding
+using fma_kernel = auto (*)(double a, double b, double c) noexcept -> double;
+
+// Picks the FMA3 implementation if the host CPU supports it
+auto select_fma() noexcept -> fma_kernel;
+
+}   // namespace fp
+}   // namespace reqvm
@@ -0,0 +1,198 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "hash_table.hpp"
+
+#include "bits.hpp"
+
+#include <utility>
+
+#if defined(__SSE2__)
+#    define REQVM_HAS_SSE2_GROUPS 1
+#    include <emmintrin.h>
+#endif
+
+namespace reqvm {
+
+static constexpr std::int8_t empty   = -128;   // 0b1000'0000
+static constexpr std::int8_t deleted = -2;     // 0b1111'1110
+
+// Full slots have the high bit of their control byte clear
+static auto h2_of(std::uint64_t hash) noexcept -> std::int8_t {
+    return static_cast<std::int8_t>(hash & 0x7f);
+}
+
+static auto hash_of(std::uint64_t key) noexcept -> std::uint64_t {
+    // The finalizer of MurmurHash3, so sequential keys spread over all groups
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccd;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53;
+    key ^= key >> 33;
+    return key;
+}
+
+/*
+ * Bit i of the masks these return is set if the control byte i of the group
+ * starting at `control` matches.
+ */
+#if defined(REQVM_HAS_SSE2_GROUPS)
+static auto match(const std::int8_t* control, std::int8_t val) noexcept
+    -> std::uint32_t {
+    auto group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(val))));
+}
+
+static auto match_empty_or_deleted(const std::int8_t* control) noexcept
+    -> std::uint32_t {
+    auto group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(group));
+}
+#else
+static auto match(const std::int8_t* control, std::int8_t val) noexcept
+    -> std::uint32_t {
+    std::uint32_t mask {0};
+    for (std::size_t i = 0; i < hash_table::group_size; i++) {
+        mask |= static_cast<std::uint32_t>(control[i] == val) << i;
+    }
+    return mask;
+}
+
+static auto match_empty_or_deleted(const std::int8_t* control) noexcept
+    -> std::uint32_t {
+    std::uint32_t mask {0};
+    for (std::size_t i = 0; i < hash_table::group_size; i++) {
+        mask |= static_cast<std::uint32_t>(control[i] < 0) << i;
+    }
+    return mask;
+}
+#endif
+
+hash_table::hash_table() {
+    rehash(group_size);
+}
+
+/*
+ * Probing visits whole groups, in a triangular sequence which reaches every
+ * group as the number of groups is a power of two. A lookup can stop at the
+ * first group with an empty slot, as an insertion would have used it.
+ */
+auto hash_table::find_index(std::uint64_t key, std::uint64_t hash) const
+    noexcept -> std::size_t {
+    const auto groups_mask = _control.size() / group_size - 1;
+    const auto h2          = h2_of(hash);
+    auto group             = (hash >> 7) & groups_mask;
+    for (std::size_t step = 1;; step++) {
+        const auto* control = _control.data() + group * group_size;
+        for (auto mask = match(control, h2); mask != 0; mask &= mask - 1) {
+            auto idx = group * group_size + bits::count_trailing_zeros(mask);
+            if (_slots[idx].key == key) {
+                return idx;
+            }
+        }
+        if (match(control, empty) != 0) {
+            return _slots.size();
+        }
+        group = (group + step) & groups_mask;
+    }
+}
+
+auto hash_table::find_free_index(std::uint64_t hash) const noexcept
+    -> std::size_t {
+    const auto groups_mask = _control.size() / group_size - 1;
+    auto group             = (hash >> 7) & groups_mask;
+    for (std::size_t step = 1;; step++) {
+        auto mask = match_empty_or_deleted(_control.data() + group * group_size);
+        if (mask != 0) {
+            return group * group_size + bits::count_trailing_zeros(mask);
+        }
+        group = (group + step) & groups_mask;
+    }
+}
+
+auto hash_table::find(std::uint64_t key) const noexcept
+    -> const std::uint64_t* {
+    auto idx = find_index(key, hash_of(key));
+    return idx == _slots.size() ? nullptr : &_slots[idx].value;
+}
+
+auto hash_table::insert_or_assign(std::uint64_t key, std::uint64_t value)
+    -> bool {
+    auto hash = hash_of(key);
+    auto idx  = find_index(key, hash);
+    if (idx != _slots.size()) {
+        _slots[idx].value = value;
+        return true;
+    }
+    idx = find_free_index(hash);
+    if (_growth_left == 0 && _control[idx] == empty) {
+        // Mostly tombstones can be cleaned up in place, otherwise we grow
+        auto capacity = _slots.size();
+        rehash(_size >= capacity * 7 / 16 ? capacity * 2 : capacity);
+        idx = find_free_index(hash);
+    }
+    _growth_left -= _control[idx] == empty;
+    _control[idx] = h2_of(hash);
+    _slots[idx]   = {key, value};
+    _size++;
+    return false;
+}
+
+auto hash_table::erase(std::uint64_t key) noexcept -> bool {
+    auto idx = find_index(key, hash_of(key));
+    if (idx == _slots.size()) {
+        return false;
+    }
+    // If the group still has an empty slot no probe sequence went past it, so
+    // the slot can become empty again instead of a tombstone
+    const auto* control = _control.data() + idx / group_size * group_size;
+    if (match(control, empty) != 0) {
+        _control[idx] = empty;
+        _growth_left++;
+    } else {
+        _control[idx] = deleted;
+    }
+    _size--;
+    return true;
+}
+
+auto hash_table::rehash(std::size_t capacity) -> void {
+    auto old_control = std::move(_control);
+    auto old_slots   = std::move(_slots);
+    _control.assign(capacity, empty);
+    _slots.assign(capacity, slot {});
+    // Keep the load factor at most 7/8
+    _growth_left = capacity - capacity / 8 - _size;
+    for (std::size_t i = 0; i < old_slots.size(); i++) {
+        if (old_control[i] >= 0) {
+            auto hash     = hash_of(old_slots[i].key);
+            auto idx      = find_free_index(hash);
+            _control[idx] = h2_of(hash);
+            _slots[idx]   = old_slots[i];
+        }
+    }
+}
+
+}   // namespace reqvm
@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reqvm {
+
+/*
+ * The hash tables behind the `ht*` instructions, mapping 64-bit keys to 64-bit
+ * values.
+ *
+ * The layout follows Swiss tables: the slots are split into groups of
+ * group_size, and every slot has a control byte, which is either empty,
+ * deleted, or 7 bits of the hash of the key it holds. A lookup compares the
+ * control bytes of a whole group against the hash at once (with SSE2 where
+ * available), so the keys themselves are only looked at on a likely match.
+ */
+class hash_table final {
+public:
+    static constexpr std::size_t group_size = 16;
+
+    hash_table();
+
+    // Returns the value of `key`, or nullptr if the table does not contain it
+    auto find(std::uint64_t key) const noexcept -> const std::uint64_t*;
+    // Returns true if `key` was already present, and its value replaced
+    auto insert_or_assign(std::uint64_t key, std::uint64_t value) -> bool;
+    // Returns true if `key` was present
+    auto erase(std::uint64_t key) noexcept -> bool;
+
+    auto size() const noexcept -> std::size_t {
+        return _size;
+    }
+
+private:
+    struct slot {
+        std::uint64_t key;
+        std::uint64_t value;
+    };
+
+    auto find_index(std::uint64_t key, std::uint64_t hash) const noexcept
+        -> std::size_t;
+    // Returns the index of the first empty or deleted slot on the probe
+    // sequence of `hash`
+    auto find_free_index(std::uint64_t hash) const noexcept -> std::size_t;
+    auto rehash(std::size_t capacity) -> void;
+
+    std::vector<std::int8_t> _control;
+    std::vector<slot> _slots;
+    std::size_t _size {0};
+    // How many more empty slots can be filled before rehashing
+    std::size_t _growth_left {0};
+};
+
+}   // namespace reqvm
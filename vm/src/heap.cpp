@@ -0,0 +1,250 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "heap.hpp"
+
+#include "bits.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace reqvm {
+
+static auto size_class_of(std::uint64_t size) noexcept -> std::size_t {
+    if (size <= heap::min_block) {
+        return 0;
+    }
+    // The number of bits needed for size - 1 is log2 of the rounded up size
+    return 64 - bits::count_leading_zeros(size - 1) - 4;
+}
+
+static auto block_size_of(std::size_t size_class) noexcept -> std::uint64_t {
+    return heap::min_block << size_class;
+}
+
+auto heap::reset(std::uint64_t base, std::uint64_t end) -> void {
+    _base = base;
+    _chunks.assign(end > base ? (end - base) / chunk_size : 0, chunk {});
+    _bump = 0;
+    _free_runs.clear();
+    _partial_slabs.fill(no_chunk);
+}
+
+auto heap::take_chunks(std::uint64_t count) -> std::uint64_t {
+    // The shortest run which is long enough, the lowest one of those
+    auto run = _free_runs.lower_bound({count, 0});
+    if (run != _free_runs.end()) {
+        auto [length, first] = *run;
+        _free_runs.erase(run);
+        if (length > count) {
+            auto rest                         = first + count;
+            _chunks[rest].count               = length - count;
+            _chunks[first + length - 1].count = length - count;
+            _free_runs.emplace(length - count, rest);
+        }
+        return first;
+    }
+    if (_chunks.size() - _bump < count) {
+        return _chunks.size();
+    }
+    _bump += count;
+    return _bump - count;
+}
+
+/*
+ * Every unused chunk below the bump pointer belongs to a single free run, and
+ * the first and last chunks of a run hold its length. This way the runs next
+ * to the given back chunks are found without a search.
+ */
+auto heap::give_back_chunks(std::uint64_t first, std::uint64_t count) noexcept
+    -> void {
+    for (auto i = first; i < first + count; i++) {
+        _chunks[i].kind = unused;
+    }
+    if (first > 0 && _chunks[first - 1].kind == unused) {
+        auto length = _chunks[first - 1].count;
+        first -= length;
+        count += length;
+        _free_runs.erase({length, first});
+    }
+    auto end = first + count;
+    if (end == _bump) {
+        _bump = first;
+        return;
+    }
+    if (_chunks[end].kind == unused) {
+        auto length = _chunks[end].count;
+        _free_runs.erase({length, end});
+        count += length;
+    }
+    _chunks[first].count             = count;
+    _chunks[first + count - 1].count = count;
+    _free_runs.emplace(count, first);
+}
+
+auto heap::link_slab(std::uint64_t idx) noexcept -> void {
+    auto& head        = _partial_slabs[_chunks[idx].kind];
+    _chunks[idx].prev = no_chunk;
+    _chunks[idx].next = head;
+    if (head != no_chunk) {
+        _chunks[head].prev = idx;
+    }
+    head = idx;
+}
+
+auto heap::unlink_slab(std::uint64_t idx) noexcept -> void {
+    auto& slab = _chunks[idx];
+    if (slab.prev != no_chunk) {
+        _chunks[slab.prev].next = slab.next;
+    } else {
+        _partial_slabs[slab.kind] = slab.next;
+    }
+    if (slab.next != no_chunk) {
+        _chunks[slab.next].prev = slab.prev;
+    }
+}
+
+auto heap::make_slab(std::size_t size_class) -> bool {
+    auto idx = take_chunks(1);
+    if (idx == _chunks.size()) {
+        return false;
+    }
+    const auto blocks = chunk_size / block_size_of(size_class);
+    auto& slab        = _chunks[idx];
+    slab.kind         = static_cast<std::uint8_t>(size_class);
+    slab.count        = 0;
+    slab.fresh        = 0;
+    slab.free.clear();
+    slab.in_use.assign((blocks + 63) / 64, 0);
+    link_slab(idx);
+    _stats.slabs++;
+    return true;
+}
+
+auto heap::note_allocation(std::uint64_t requested, std::uint64_t size) noexcept
+    -> void {
+    _stats.allocations++;
+    _stats.bytes_requested += requested;
+    _stats.bytes_in_use += size;
+    _stats.peak_bytes_in_use =
+        std::max(_stats.peak_bytes_in_use, _stats.bytes_in_use);
+}
+
+auto heap::allocate(std::uint64_t size) -> std::uint64_t {
+    if (size <= max_block) {
+        auto size_class = size_class_of(size);
+        if (_partial_slabs[size_class] == no_chunk
+            && not make_slab(size_class)) {
+            _stats.failed_allocations++;
+            return 0;
+        }
+        const auto block_size = block_size_of(size_class);
+        auto idx              = _partial_slabs[size_class];
+        auto& slab            = _chunks[idx];
+        std::uint64_t block {0};
+        if (not slab.free.empty()) {
+            block = slab.free.back();
+            slab.free.pop_back();
+        } else {
+            block = slab.fresh++;
+        }
+        slab.in_use[block / 64] |= std::uint64_t {1} << block % 64;
+        slab.count++;
+        if (slab.count == chunk_size / block_size) {
+            unlink_slab(idx);
+        }
+        note_allocation(size, block_size);
+        return _base + idx * chunk_size + block * block_size;
+    }
+    auto count = size / chunk_size + (size % chunk_size != 0);
+    auto idx   = take_chunks(count);
+    if (idx == _chunks.size()) {
+        _stats.failed_allocations++;
+        return 0;
+    }
+    _chunks[idx].kind  = large_head;
+    _chunks[idx].count = count;
+    for (auto i = idx + 1; i < idx + count; i++) {
+        _chunks[i].kind = large_tail;
+    }
+    _stats.large_allocations++;
+    note_allocation(size, count * chunk_size);
+    return _base + idx * chunk_size;
+}
+
+auto heap::deallocate(std::uint64_t address) -> void {
+    if (address < _base || address - _base >= _bump * chunk_size) {
+        bad_free(address);
+    }
+    auto offset = address - _base;
+    auto idx    = offset / chunk_size;
+    auto& c     = _chunks[idx];
+    if (c.kind < class_count) {
+        const auto block_size = block_size_of(c.kind);
+        auto block            = offset % chunk_size / block_size;
+        auto bit              = std::uint64_t {1} << block % 64;
+        if (offset % block_size != 0 || (c.in_use[block / 64] & bit) == 0) {
+            bad_free(address);
+        }
+        c.in_use[block / 64] &= ~bit;
+        _stats.bytes_in_use -= block_size;
+        if (c.count-- == chunk_size / block_size) {
+            link_slab(idx);
+        }
+        if (c.count == 0) {
+            unlink_slab(idx);
+            c.free.clear();
+            c.in_use.clear();
+            give_back_chunks(idx, 1);
+        } else {
+            c.free.push_back(static_cast<std::uint16_t>(block));
+        }
+    } else if (c.kind == large_head && offset % chunk_size == 0) {
+        auto count = c.count;
+        give_back_chunks(idx, count);
+        _stats.bytes_in_use -= count * chunk_size;
+    } else {
+        bad_free(address);
+    }
+    _stats.frees++;
+}
+
+auto heap::release_all() noexcept -> void {
+    _stats.bytes_released_in_bulk += _stats.bytes_in_use;
+    _stats.bytes_in_use = 0;
+    for (std::uint64_t i = 0; i < _bump; i++) {
+        _chunks[i] = chunk {};
+    }
+    _bump = 0;
+    _free_runs.clear();
+    _partial_slabs.fill(no_chunk);
+}
+
+auto heap::bad_free(std::uint64_t address) const -> void {
+    throw memory_error {"The binary has tried to free the address "
+                        + std::to_string(address)
+                        + ", which is not a block allocated on the heap."};
+}
+
+}   // namespace reqvm
@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "memory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace reqvm {
+
+/*
+ * The allocator behind `alloc` and `free`, managing the heap: the part of the
+ * linear memory between the heap base and the end of the memory.
+ *
+ * The heap is split into chunks of chunk_size bytes, handed out by a bump
+ * pointer. Allocations of at most max_block bytes are rounded up to a power of
+ * two size class, and served from slabs, chunks cut into blocks of a single
+ * class. Larger allocations get a run of whole chunks. A slab is given back as
+ * soon as its last block is freed, and chunks given back are merged with the
+ * free runs next to them, or returned to the bump pointer when they end at it.
+ * All the bookkeeping is kept on the host, so a binary writing past the end of
+ * its blocks cannot corrupt the allocator.
+ */
+class heap final {
+public:
+    static constexpr std::uint64_t chunk_size  = memory::granularity;
+    static constexpr std::uint64_t min_block   = 16;
+    static constexpr std::uint64_t max_block   = 8 * 1024;
+    static constexpr std::size_t   class_count = 10;
+
+    struct statistics {
+        std::uint64_t allocations {0};
+        std::uint64_t large_allocations {0};
+        std::uint64_t failed_allocations {0};
+        std::uint64_t frees {0};
+        // The sizes the binary asked for, summed over all allocations
+        std::uint64_t bytes_requested {0};
+        // The sizes of the blocks handed out, which are rounded up
+        std::uint64_t bytes_in_use {0};
+        std::uint64_t peak_bytes_in_use {0};
+        std::uint64_t slabs {0};
+        // What was still allocated when release_all() was called
+        std::uint64_t bytes_released_in_bulk {0};
+    };
+
+    heap() noexcept {
+        _partial_slabs.fill(no_chunk);
+    }
+
+    // Manages the bytes in [base, end), forgetting all previous allocations
+    auto reset(std::uint64_t base, std::uint64_t end) -> void;
+
+    // Returns the address of a block of at least `size` bytes, aligned to
+    // min_block bytes, or 0 if the heap is exhausted
+    auto allocate(std::uint64_t size) -> std::uint64_t;
+    // Throws a memory_error if `address` is not the start of a block which is
+    // in use
+    auto deallocate(std::uint64_t address) -> void;
+    // Frees every block at once
+    auto release_all() noexcept -> void;
+
+    auto stats() const noexcept -> const statistics& {
+        return _stats;
+    }
+
+private:
+    // The kind of a chunk is the size class of the slab it holds, or one of
+    // these
+    static constexpr std::uint8_t unused     = 0xff;
+    static constexpr std::uint8_t large_head = 0xfe;
+    static constexpr std::uint8_t large_tail = 0xfd;
+
+    static constexpr std::uint64_t no_chunk = ~std::uint64_t {0};
+
+    struct chunk {
+        std::uint8_t kind {unused};
+        // The blocks in use of a slab, the length of a large allocation, or
+        // the length of the free run the chunk starts or ends
+        std::uint64_t count {0};
+        // The slabs of a class with free blocks are linked through these
+        std::uint64_t prev {no_chunk};
+        std::uint64_t next {no_chunk};
+        // The blocks of a slab from here on have never been handed out
+        std::uint32_t fresh {0};
+        // The freed blocks of a slab, handed out again first
+        std::vector<std::uint16_t> free;
+        // One bit per block of a slab, set while the block is in use
+        std::vector<std::uint64_t> in_use;
+    };
+
+    // Returns the first of `count` unused consecutive chunks, which are taken
+    // out of the free runs or the bump pointer, or _chunks.size() if there
+    // are none
+    auto take_chunks(std::uint64_t count) -> std::uint64_t;
+    // Makes the `count` chunks starting at `first` unused
+    auto give_back_chunks(std::uint64_t first, std::uint64_t count) noexcept
+        -> void;
+    auto make_slab(std::size_t size_class) -> bool;
+    auto link_slab(std::uint64_t idx) noexcept -> void;
+    auto unlink_slab(std::uint64_t idx) noexcept -> void;
+    auto note_allocation(std::uint64_t requested, std::uint64_t size) noexcept
+        -> void;
+    [[noreturn]] auto bad_free(std::uint64_t address) const -> void;
+
+    std::uint64_t _base {0};
+    std::vector<chunk> _chunks;
+    // The chunks from here on have never been handed out
+    std::uint64_t _bump {0};
+    // The runs of unused chunks below the bump pointer, as their lengths and
+    // first chunks
+    std::set<std::pair<std::uint64_t, std::uint64_t>> _free_runs;
+    // The first slab with free blocks of each class
+    std::array<std::uint64_t, class_count> _partial_slabs;
+    statistics _stats;
+};
+
+}   // namespace reqvm
@@ -24,12 +24,113 @@
 
 #include "io.hpp"
 
-#include <cinttypes>
+#include "detect_platform.hpp"
+
+#include <algorithm>
+#include <cctype>
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace reqvm {
 namespace io {
 
+// Valid trace files must start with this string
+static constexpr char trace_magic[] = "!reqvm-io-trace;\n";
+
+enum class trace_mode {
+    none,
+    record,
+    replay,
+};
+
+/*
+ * The state of the I/O trace.
+ *
+ * While recording `input` and `output` accumulate what went through stdio,
+ * while replaying they hold the contents of the trace file, and the positions
+ * track how much of them the binary has consumed so far.
+ */
+static struct {
+    trace_mode mode {trace_mode::none};
+    std::filesystem::path path;
+    std::vector<std::uint8_t> input;
+    std::vector<std::uint8_t> output;
+    std::size_t input_pos {0};
+    std::size_t output_pos {0};
+} trace;
+
+static auto write_u64(std::ofstream& out, std::uint64_t num) -> void {
+    const char bytes[] = {static_cast<char>(num >> 56),
+                          static_cast<char>((num << 8) >> 56),
+                          static_cast<char>((num << 16) >> 56),
+                          static_cast<char>((num << 24) >> 56),
+                          static_cast<char>((num << 32) >> 56),
+                          static_cast<char>((num << 40) >> 56),
+                          static_cast<char>((num << 48) >> 56),
+                          static_cast<char>((num << 56) >> 56)};
+    out.write(bytes, sizeof(bytes));
+}
+
+static auto read_u64(std::ifstream& in) -> std::uint64_t {
+    unsigned char bytes[8];
+    if (not in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        throw trace_error {"The I/O trace file is truncated."};
+    }
+    std::uint64_t num {0};
+    for (auto byte : bytes) {
+        num = num << 8 | byte;
+    }
+    return num;
+}
+
+static auto read_block(std::ifstream& in, std::vector<std::uint8_t>& block)
+    -> void {
+    block.resize(read_u64(in));
+    if (not in.read(reinterpret_cast<char*>(block.data()), block.size())) {
+        throw trace_error {"The I/O trace file is truncated."};
+    }
+}
+
+// Nobody else reads stdin, so we can skip locking it for every byte
+static auto read_byte() -> int {
+#if defined(REQVM_ON_WINDOWS)
+    return _getc_nolock(stdin);
+#elif defined(REQVM_ON_POSIX)
+    return getc_unlocked(stdin);
+#endif
+}
+
+// Every output operation funnels its bytes through here
+static auto write(const char* bytes, std::size_t count) -> void {
+    switch (trace.mode) {
+    case trace_mode::none:
+        std::fwrite(bytes, 1, count, stdout);
+        break;
+    case trace_mode::record:
+        std::fwrite(bytes, 1, count, stdout);
+        trace.output.insert(trace.output.end(), bytes, bytes + count);
+        break;
+    case trace_mode::replay:
+        for (std::size_t i = 0; i < count; i++) {
+            if (trace.output_pos == trace.output.size()
+                || trace.output[trace.output_pos]
+                       != static_cast<std::uint8_t>(bytes[i])) {
+                throw trace_error {
+                    "The output of the binary diverged from the I/O trace at "
+                    "byte "
+                    + std::to_string(trace.output_pos) + "."};
+            }
+            trace.output_pos++;
+        }
+        break;
+    }
+}
+
 common::io_op parse_from_byte(std::uint8_t byte) {
     using common::io_op;
     switch (byte) {
@@ -41,17 +142,46 @@ common::io_op parse_from_byte(std::uint8_t byte) {
         return io_op::put8c;
     case 4:
         return io_op::putn;
+    case 5:
+        return io_op::putf;
+    case 6:
+        return io_op::getf;
+    case 7:
+        return io_op::getn;
+    case 8:
+        return io_op::putns;
+    case 9:
+        return io_op::setsep;
+    case 10:
+        return io_op::putm;
     default:
         throw error {"Unknown operation passed as argument to 'io': ", byte};
     }
 }
 
 auto getc() -> std::uint64_t {
-    return static_cast<std::uint64_t>(std::fgetc(stdin));
+    switch (trace.mode) {
+    case trace_mode::none:
+        break;
+    case trace_mode::record: {
+        auto ch = read_byte();
+        if (ch != EOF) {
+            trace.input.push_back(static_cast<std::uint8_t>(ch));
+        }
+        return static_cast<std::uint64_t>(ch);
+    }
+    case trace_mode::replay:
+        if (trace.input_pos == trace.input.size()) {
+            return static_cast<std::uint64_t>(EOF);
+        }
+        return trace.input[trace.input_pos++];
+    }
+    return static_cast<std::uint64_t>(read_byte());
 }
 
 auto putc(std::uint64_t ch) -> void {
-    std::putc(static_cast<char>(ch), stdout);
+    const auto as_char = static_cast<char>(ch);
+    write(&as_char, 1);
 }
 
 auto put8c(std::uint64_t string) -> void {
@@ -64,14 +194,176 @@ auto put8c(std::uint64_t string) -> void {
     chars[5]      = static_cast<char>((string << 40) >> 56);
     chars[6]      = static_cast<char>((string << 48) >> 56);
     chars[7]      = static_cast<char>((string << 56) >> 56);
-    for (auto ch : chars) {
-        std::putc(ch, stdout);
+    write(chars, sizeof(chars));
+}
+
+static constexpr char digit_pairs[] = "00010203040506070809"
+                                      "10111213141516171819"
+                                      "20212223242526272829"
+                                      "30313233343536373839"
+                                      "40414243444546474849"
+                                      "50515253545556575859"
+                                      "60616263646566676869"
+                                      "70717273747576777879"
+                                      "80818283848586878889"
+                                      "90919293949596979899";
+
+/*
+ * Writes `num` as a signed decimal number ending right before `end`, and
+ * returns where it starts. Two digits are produced per division, halving the
+ * (dependent) divisions printf would do.
+ */
+static auto format_number(std::uint64_t num, char* end) noexcept -> char* {
+    const auto negative = static_cast<std::int64_t>(num) < 0;
+    auto magnitude      = negative ? 0 - num : num;
+    while (magnitude >= 100) {
+        auto pair = magnitude % 100 * 2;
+        magnitude /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
     }
+    if (magnitude >= 10) {
+        *--end = digit_pairs[magnitude * 2 + 1];
+        *--end = digit_pairs[magnitude * 2];
+    } else {
+        *--end = static_cast<char>('0' + magnitude);
+    }
+    if (negative) {
+        *--end = '-';
+    }
+    return end;
 }
 
 auto putn(std::uint64_t num) -> void {
-    std::fprintf(stdout, "%" PRId64, num);
+    char digits[24];
+    auto end   = digits + sizeof(digits);
+    auto start = format_number(num, end);
+    write(start, static_cast<std::size_t>(end - start));
+}
+
+static char separator {'\n'};
+
+auto putns(std::uint64_t num) -> void {
+    char digits[24];
+    auto end   = digits + sizeof(digits);
+    *--end     = separator;
+    auto start = format_number(num, end);
+    write(start, static_cast<std::size_t>(digits + sizeof(digits) - start));
+}
+
+auto set_separator(std::uint64_t ch) -> void {
+    separator = static_cast<char>(ch);
+}
+
+/*
+ * stdio already copies small writes into its buffer, and hands writes larger
+ * than the buffer to the OS directly, so a single call is all we need.
+ */
+auto putm(const std::uint8_t* bytes, std::size_t count) -> void {
+    write(reinterpret_cast<const char*>(bytes), count);
+}
+
+auto getn() -> std::optional<std::uint64_t> {
+    constexpr auto eof = static_cast<std::uint64_t>(EOF);
+    auto ch            = getc();
+    while (ch != eof && std::isspace(static_cast<int>(ch))) {
+        ch = getc();
+    }
+    const auto negative = ch == '-';
+    if (ch == '-' || ch == '+') {
+        ch = getc();
+    }
+    // Digits are the only characters for which this is below 10, EOF included
+    if (ch - '0' >= 10) {
+        return {};
+    }
+    std::uint64_t num {0};
+    do {
+        num = num * 10 + (ch - '0');
+        ch  = getc();
+    } while (ch - '0' < 10);
+    return negative ? 0 - num : num;
+}
+
+auto putf(double num) -> void {
+    char digits[32];
+    auto count = std::snprintf(digits, sizeof(digits), "%.17g", num);
+    write(digits, static_cast<std::size_t>(count));
+}
+
+auto getf() -> double {
+    constexpr auto eof = static_cast<std::uint64_t>(EOF);
+    auto ch            = getc();
+    while (ch != eof && std::isspace(static_cast<int>(ch))) {
+        ch = getc();
+    }
+    std::string text;
+    while (ch != eof && not std::isspace(static_cast<int>(ch))) {
+        text.push_back(static_cast<char>(ch));
+        ch = getc();
+    }
+    char* end {nullptr};
+    auto num = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0') {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return num;
+}
+
+auto record_trace_to(const std::filesystem::path& path) -> void {
+    trace.mode = trace_mode::record;
+    trace.path = path;
+}
+
+auto replay_trace_from(const std::filesystem::path& path) -> void {
+    std::ifstream the_file {path, std::ios::binary};
+    if (not the_file) {
+        throw trace_error {"Could not open the I/O trace file '"
+                           + path.string() + "'."};
+    }
+    char magic[sizeof(trace_magic) - 1];
+    if (not the_file.read(magic, sizeof(magic))
+        || not std::equal(std::begin(magic), std::end(magic), trace_magic)) {
+        throw trace_error {"'" + path.string()
+                           + "' is not a reqvm I/O trace file."};
+    }
+    read_block(the_file, trace.input);
+    read_block(the_file, trace.output);
+    trace.mode = trace_mode::replay;
+    trace.path = path;
+}
+
+auto finish_trace() -> void {
+    switch (trace.mode) {
+    case trace_mode::none:
+        break;
+    case trace_mode::record: {
+        std::ofstream the_file {trace.path, std::ios::binary};
+        the_file.write(trace_magic, sizeof(trace_magic) - 1);
+        write_u64(the_file, trace.input.size());
+        the_file.write(reinterpret_cast<const char*>(trace.input.data()),
+                       trace.input.size());
+        write_u64(the_file, trace.output.size());
+        the_file.write(reinterpret_cast<const char*>(trace.output.data()),
+                       trace.output.size());
+        if (not the_file) {
+            throw trace_error {"Could not write the I/O trace file '"
+                               + trace.path.string() + "'."};
+        }
+        break;
+    }
+    case trace_mode::replay:
+        if (trace.output_pos != trace.output.size()) {
+            throw trace_error {
+                "The binary produced less output than recorded in the I/O "
+                "trace: "
+                + std::to_string(trace.output_pos) + " out of "
+                + std::to_string(trace.output.size()) + " bytes."};
+        }
+        break;
+    }
+    trace.mode = trace_mode::none;
 }
 
 }   // namespace io
-}   // namespace reqvm
\ No newline at end of file
+}   // namespace reqvm
@@ -26,8 +26,12 @@
 
 #include "../../common/opcodes.hpp"
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <optional>
 #include <stdexcept>
+#include <string>
 
 namespace reqvm {
 namespace io {
@@ -38,6 +42,34 @@ auto getc() -> std::uint64_t;
 auto putc(std::uint64_t ch) -> void;
 auto put8c(std::uint64_t chars) -> void;
 auto putn(std::uint64_t num) -> void;
+// Doubles are printed with enough digits to be read back exactly
+auto putf(double num) -> void;
+// Reads a whitespace delimited double, consuming the whitespace ending it.
+// Returns NaN if the text read is not a number
+auto getf() -> double;
+// Reads a whitespace delimited, optionally signed, decimal integer, consuming
+// the character ending it. Returns nothing if there are no digits to read
+auto getn() -> std::optional<std::uint64_t>;
+// Like putn, followed by the separator set by set_separator ('\n' by default)
+auto putns(std::uint64_t num) -> void;
+auto set_separator(std::uint64_t ch) -> void;
+// Outputs `count` bytes at once
+auto putm(const std::uint8_t* bytes, std::size_t count) -> void;
+
+/*
+ * I/O traces make runs of a binary reproducible.
+ *
+ * When recording, every byte read by `getc` and every byte written by the
+ * output operations is captured while still going to the real stdin/stdout,
+ * and written to the trace file by finish_trace().
+ *
+ * When replaying, the recorded input is fed back from memory and the output of
+ * the binary is checked byte-for-byte against the recorded output. Real stdio
+ * is never touched in this mode.
+ */
+auto record_trace_to(const std::filesystem::path& trace) -> void;
+auto replay_trace_from(const std::filesystem::path& trace) -> void;
+auto finish_trace() -> void;
 
 class error : public std::runtime_error {
 public:
@@ -55,5 +87,15 @@ private:
     std::uint8_t _op;
 };
 
+class trace_error : public std::runtime_error {
+public:
+    // Delete default constructor to force a meaningful message
+    trace_error() = delete;
+    explicit trace_error(const char* what_arg) : runtime_error {what_arg} {}
+    explicit trace_error(const std::string& what_arg)
+        : runtime_error {what_arg} {}
+    virtual ~trace_error() noexcept = default;
+};
+
 }   // namespace io
 }   // namespace reqvm
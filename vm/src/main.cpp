@@ -28,8 +28,10 @@
 #include "io.hpp"
 #include "vm.hpp"
 
+#include <cinttypes>
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <memory>
 
 static constexpr auto panic = R"(
@@ -43,15 +45,85 @@ static constexpr auto panic = R"(
 
 )";
 
+/*
+ * Writes the I/O trace when main is left, so the trace of a run which stops
+ * with an error is kept too. The errors of the trace itself are only reported
+ * on success, by the explicit finish_trace() call.
+ */
+struct trace_finisher {
+    ~trace_finisher() noexcept {
+        try {
+            reqvm::io::finish_trace();
+        } catch (...) {
+        }
+    }
+};
+
 using std::printf;
 using std::puts;
 auto main(int argc, char** argv) -> int try {
-    if (argc < 2) {
-        printf("usage: vm binary.reqvm");
-        return EXIT_SUCCESS;
+    trace_finisher finisher;
+    const char* binary {nullptr};
+    const char* input {nullptr};
+    bool cache_stack_top {false};
+    bool heap_stats {false};
+    const char* sandbox {nullptr};
+    const char* record_io {nullptr};
+    const char* replay_io {nullptr};
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--map-input") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache-stack-top") == 0) {
+            cache_stack_top = true;
+        } else if (std::strcmp(argv[i], "--sandbox") == 0 && i + 1 < argc) {
+            sandbox = argv[++i];
+        } else if (std::strcmp(argv[i], "--heap-stats") == 0) {
+            heap_stats = true;
+        } else if (std::strcmp(argv[i], "--record-io") == 0 && i + 1 < argc) {
+            record_io = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay-io") == 0 && i + 1 < argc) {
+            replay_io = argv[++i];
+        } else {
+            binary = argv[i];
+        }
+    }
+    // A trace is either recorded or replayed, never both
+    auto conflicting = record_io && replay_io;
+    if (not binary || conflicting) {
+        printf("usage: vm [--map-input file] [--cache-stack-top] "
+               "[--heap-stats] [--sandbox directory] "
+               "[--record-io trace | --replay-io trace] binary.reqvm");
+        return conflicting ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (record_io) {
+        reqvm::io::record_trace_to(record_io);
+    } else if (replay_io) {
+        reqvm::io::replay_trace_from(replay_io);
+    }
+    auto the_vm = reqvm::vm {binary};
+    if (input) {
+        the_vm.map_input(input);
+    }
+    if (sandbox) {
+        the_vm.sandbox_files(sandbox);
     }
-    auto the_vm = reqvm::vm {argv[1]};
-    return the_vm.run();
+    the_vm.cache_stack_top(cache_stack_top);
+    auto exit_code = the_vm.run();
+    reqvm::io::finish_trace();
+    if (heap_stats) {
+        const auto& stats = the_vm.heap_statistics();
+        std::fprintf(stderr,
+                     "heap: %" PRIu64 " allocations (%" PRIu64 " large, %" PRIu64
+                     " failed), %" PRIu64 " frees\n"
+                     "heap: %" PRIu64 " bytes requested, peak of %" PRIu64
+                     " bytes in use, %" PRIu64 " slabs\n"
+                     "heap: %" PRIu64 " bytes released at halt\n",
+                     stats.allocations, stats.large_allocations,
+                     stats.failed_allocations, stats.frees,
+                     stats.bytes_requested, stats.peak_bytes_in_use,
+                     stats.slabs, stats.bytes_released_in_bulk);
+    }
+    return exit_code;
 } catch (const reqvm::invalid_opcode& e) {
     puts(panic);
     puts("reqvm has encountered an error during the execution of your "
@@ -87,6 +159,11 @@ auto main(int argc, char** argv) -> int try {
     puts("reqvm has detected an illegal manipulation of the stack\n");
     printf("e.what(): %s\n", e.what());
     return EXIT_FAILURE;
+} catch (const reqvm::memory_error& e) {
+    puts(panic);
+    puts("reqvm has detected an illegal access to the linear memory\n");
+    printf("e.what(): %s\n", e.what());
+    return EXIT_FAILURE;
 } catch (const reqvm::preamble_error& e) {
     puts(panic);
     puts("reqvm has an ecountered an issue with the format of your binary.\n");
@@ -100,9 +177,16 @@ auto main(int argc, char** argv) -> int try {
            static_cast<unsigned int>(e.the_invalid_op()),
            static_cast<unsigned int>(e.the_invalid_op()));
     return EXIT_FAILURE;
+} catch (const reqvm::io::trace_error& e) {
+    puts(panic);
+    puts("reqvm has encountered an issue with the I/O trace of your "
+         "binary.\n");
+    printf("e.what(): %s\n", e.what());
+    return EXIT_FAILURE;
 } catch (const reqvm::mmap_error& e) {
     puts(panic);
-    puts("reqvm has encountered an issue trying to open your binary.\n");
+    puts("reqvm has encountered an issue trying to open your binary or its "
+         "input.\n");
     printf("e.what(): %s\n", e.what());
     return EXIT_FAILURE;
 #ifndef NDEBUG
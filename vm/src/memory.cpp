@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "memory.hpp"
+
+#include "sorting.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define REQVM_IN_THE_MEMORY_CPP_FILE
+#if defined(REQVM_ON_WINDOWS)
+#    include "memory.win32.ipp"
+#elif defined(REQVM_ON_POSIX)
+#    include "memory.posix.ipp"
+#endif
+#undef REQVM_IN_THE_MEMORY_CPP_FILE
+
+/*
+ * README:
+ *
+ * This file is only meant to contain the platform agnostic code of memory,
+ * all platform specific code should reside in the appropriate .ipp files.
+ */
+
+namespace reqvm {
+
+auto memory::raise_fault() -> void {
+    close_scratch_pages();
+    _faulted.store(false, std::memory_order_relaxed);
+    char message[128];
+    std::snprintf(message, sizeof(message),
+                  "The binary has tried to access memory out of bounds, at "
+                  "address %#" PRIx64 ".",
+                  _fault_address);
+    throw memory_error {message};
+}
+
+auto memory::block(std::uint64_t address, std::uint64_t count)
+    -> std::uint8_t* {
+    auto offset = static_cast<std::uint32_t>(address);
+    if (count > _size || offset > _size - count) {
+        throw memory_error {
+            "The binary has tried to access a block of memory which does not "
+            "fit in the memory, at address "
+            + std::to_string(offset) + " of length " + std::to_string(count)
+            + "."};
+    }
+    return _base + offset;
+}
+
+auto memory::elements(std::uint64_t address,
+                      std::uint64_t count,
+                      std::uint64_t size) -> std::uint8_t* {
+    // No block is larger than the memory, and that keeps count * size from
+    // overflowing
+    return block(address, count > _size ? _size + 1 : count * size);
+}
+
+auto memory::copy(std::uint64_t dst, std::uint64_t src, std::uint64_t count)
+    -> void {
+    auto to   = block(dst, count);
+    auto from = block(src, count);
+    std::memmove(to, from, count);
+}
+
+auto memory::fill(std::uint64_t dst, std::uint8_t val, std::uint64_t count)
+    -> void {
+    std::memset(block(dst, count), val, count);
+}
+
+auto memory::copy_in(std::uint64_t dst,
+                     const std::uint8_t* src,
+                     std::uint64_t count) -> void {
+    std::memcpy(block(dst, count), src, count);
+}
+
+auto memory::compare(std::uint64_t lhs, std::uint64_t rhs, std::uint64_t count)
+    -> int {
+    auto first  = block(lhs, count);
+    auto second = block(rhs, count);
+    return std::memcmp(first, second, count);
+}
+
+auto memory::find(std::uint64_t address, std::uint8_t val, std::uint64_t count)
+    -> std::uint64_t {
+    auto start = block(address, count);
+    auto found = static_cast<std::uint8_t*>(std::memchr(start, val, count));
+    return address + (found ? found - start : count);
+}
+
+/*
+ * The values are sorted in a host buffer: the block may not be aligned, and
+ * the sort works on host byte order.
+ */
+auto memory::sort(std::uint64_t address, std::uint64_t count) -> void {
+    auto start = elements(address, count, sizeof(std::uint64_t));
+    std::vector<std::uint64_t> keys(count);
+    std::memcpy(keys.data(), start, count * sizeof(std::uint64_t));
+    for (auto& key : keys) {
+        key = from_little_endian(key);
+    }
+    sorting::sort(keys.data(), keys.size());
+    for (auto& key : keys) {
+        key = from_little_endian(key);
+    }
+    std::memcpy(start, keys.data(), count * sizeof(std::uint64_t));
+}
+
+auto memory::sort_pairs(std::uint64_t address, std::uint64_t count) -> void {
+    auto start = elements(address, count, sizeof(sorting::pair));
+    std::vector<sorting::pair> pairs(count);
+    std::memcpy(pairs.data(), start, count * sizeof(sorting::pair));
+    for (auto& the_pair : pairs) {
+        the_pair.key   = from_little_endian(the_pair.key);
+        the_pair.value = from_little_endian(the_pair.value);
+    }
+    sorting::sort(pairs.data(), pairs.size());
+    for (auto& the_pair : pairs) {
+        the_pair.key   = from_little_endian(the_pair.key);
+        the_pair.value = from_little_endian(the_pair.value);
+    }
+    std::memcpy(start, pairs.data(), count * sizeof(sorting::pair));
+}
+
+auto memory::lower_bound(std::uint64_t address,
+                         std::uint64_t count,
+                         std::uint64_t key) -> std::uint64_t {
+    elements(address, count, sizeof(std::uint64_t));
+    if (count == 0) {
+        return address;
+    }
+    // Halving the range without branching on the comparison, which is
+    // unpredictable by design
+    auto first = address;
+    while (count > 1) {
+        auto half = count / 2;
+        first += load<std::uint64_t>(first + (half - 1) * 8) < key ? half * 8
+                                                                   : 0;
+        count -= half;
+    }
+    return first + (load<std::uint64_t>(first) < key) * 8;
+}
+
+}   // namespace reqvm
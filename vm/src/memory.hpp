@@ -0,0 +1,188 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "detect_platform.hpp"
+#include "utility.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace reqvm {
+
+class memory_error : public std::runtime_error {
+public:
+    explicit memory_error(const char* what_arg) : runtime_error {what_arg} {}
+    explicit memory_error(const std::string& what_arg)
+        : runtime_error {what_arg} {}
+
+    virtual ~memory_error() noexcept = default;
+};
+
+/*
+ * The linear data memory of the VM.
+ *
+ * Guest addresses are 32-bit, so the whole 4GiB guest address space (plus a
+ * guard region for accesses straddling its end) is reserved up front, and only
+ * the first size() bytes of it are made accessible. This way loads and stores
+ * never need to check their bounds: an access outside of the accessible part
+ * faults, and guarded() turns that fault into a memory_error.
+ *
+ * The fault handler does not unwind the host stack, which would skip the
+ * destructors of whatever is live in between. It makes the faulting page
+ * accessible instead, so the access completes on a page of zeros, and sets
+ * faulted(). The code running under guarded() stops at its next safe point once
+ * faulted() is set, and guarded() throws when it returns.
+ *
+ * Definitions for the platform specific member functions of this class are
+ * present in memory.{win32,posix}.ipp
+ */
+class memory final {
+    REQVM_MAKE_NONCOPYABLE(memory)
+    REQVM_MAKE_NONMOVABLE(memory)
+public:
+    static constexpr std::uint64_t address_space = std::uint64_t {1} << 32;
+    static constexpr std::uint64_t guard_size    = 64 * 1024;
+    // The size of the memory must be a multiple of this, so the end of the
+    // accessible part falls on a page boundary on every platform we care about
+    static constexpr std::uint64_t granularity  = 64 * 1024;
+    static constexpr std::uint64_t default_size = 16 * 1024 * 1024;
+
+    memory();
+    ~memory() noexcept;
+
+    // Makes the first `size` bytes of the memory accessible
+    auto commit(std::uint64_t size) -> void;
+
+    // Runs `body`, throwing a memory_error if it accesses the memory out of
+    // bounds. `body` has to return soon after faulted() becomes true.
+    auto guarded(const std::function<void()>& body) -> void;
+
+    auto faulted() const noexcept -> bool {
+        return _faulted.load(std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    auto load(std::uint64_t address) const noexcept -> T {
+        T val;
+        std::memcpy(&val, _base + static_cast<std::uint32_t>(address),
+                    sizeof(T));
+        return from_little_endian(val);
+    }
+
+    template <typename T>
+    auto store(std::uint64_t address, T val) noexcept -> void {
+        val = from_little_endian(val);
+        std::memcpy(_base + static_cast<std::uint32_t>(address), &val,
+                    sizeof(T));
+    }
+
+    // Like load and store, but for blocks of bytes which may straddle the end
+    // of the address space by at most guard_size bytes
+    auto load_bytes(std::uint64_t address, std::uint8_t* dst, std::size_t count)
+        const noexcept -> void {
+        std::memcpy(dst, _base + static_cast<std::uint32_t>(address), count);
+    }
+    auto store_bytes(std::uint64_t address,
+                     const std::uint8_t* src,
+                     std::size_t count) noexcept -> void {
+        std::memcpy(_base + static_cast<std::uint32_t>(address), src, count);
+    }
+
+    // Returns the `count` bytes at `address`, throwing a memory_error if they
+    // do not fit in the memory
+    auto view(std::uint64_t address, std::uint64_t count)
+        -> const std::uint8_t* {
+        return block(address, count);
+    }
+
+    /*
+     * Bulk operations on blocks of memory. As their lengths are arbitrary, they
+     * check their bounds explicitly and throw a memory_error when the block
+     * does not fit in the memory.
+     */
+
+    // Copies `count` bytes from `src` to `dst`, the blocks may overlap
+    auto copy(std::uint64_t dst, std::uint64_t src, std::uint64_t count)
+        -> void;
+    auto fill(std::uint64_t dst, std::uint8_t val, std::uint64_t count)
+        -> void;
+    // Copies `count` bytes from outside of the memory to `dst`
+    auto copy_in(std::uint64_t dst, const std::uint8_t* src, std::uint64_t count)
+        -> void;
+    // Returns a negative number, zero or a positive number, like memcmp does
+    auto compare(std::uint64_t lhs, std::uint64_t rhs, std::uint64_t count)
+        -> int;
+    // Returns the address of the first byte equal to `val`, or `address +
+    // count` if there is none
+    auto find(std::uint64_t address, std::uint8_t val, std::uint64_t count)
+        -> std::uint64_t;
+    // Sorts the `count` 8-byte values at `address` in ascending order
+    auto sort(std::uint64_t address, std::uint64_t count) -> void;
+    // Sorts the `count` pairs of 8-byte values at `address` by their first
+    // value, keeping the order of pairs whose first values are equal
+    auto sort_pairs(std::uint64_t address, std::uint64_t count) -> void;
+    // Returns the address of the first of the `count` sorted 8-byte values at
+    // `address` which is not less than `key`, or the address past the last
+    // value if there is none
+    auto lower_bound(std::uint64_t address,
+                     std::uint64_t count,
+                     std::uint64_t key) -> std::uint64_t;
+
+    auto size() const noexcept -> std::uint64_t {
+        return _size;
+    }
+    auto data() noexcept -> std::uint8_t* {
+        return _base;
+    }
+
+    static auto is_valid_size(std::uint64_t size) noexcept -> bool {
+        return size <= address_space && size % granularity == 0;
+    }
+
+private:
+    friend struct fault_handler;
+
+    // Makes the pages opened by the fault handler inaccessible again, and
+    // throws the memory_error for the first faulting access
+    [[noreturn]] auto raise_fault() -> void;
+    auto close_scratch_pages() noexcept -> void;
+
+    auto block(std::uint64_t address, std::uint64_t count) -> std::uint8_t*;
+    // Like block, for `count` elements of `size` bytes
+    auto elements(std::uint64_t address, std::uint64_t count, std::uint64_t size)
+        -> std::uint8_t*;
+
+    std::uint8_t* _base {nullptr};
+    std::uint64_t _size {0};
+    std::atomic<bool> _faulted {false};
+    std::uint64_t _fault_address {0};
+};
+
+}   // namespace reqvm
@@ -0,0 +1,181 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "memory.hpp"
+
+/*
+ * README:
+ *
+ * Please note that this is not a classical header file (and as such lacks a
+ * #pragma once directive) and is only meant to contain the POSIX specific
+ * code of memory.
+ */
+
+#if !defined(REQVM_ON_POSIX)
+#    error "This file should only be used when compiling for POSIX OS'es"
+#endif
+
+#if !defined(REQVM_IN_THE_MEMORY_CPP_FILE)
+#    error "This file should only be included by memory.cpp"
+#endif
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace reqvm {
+
+// The memory guarded on this thread
+static thread_local memory* guarded_memory {nullptr};
+
+/*
+ * The SIGSEGV and SIGBUS handlers are process wide, so they are installed once
+ * and stay installed. Faults outside of the memory guarded on the faulting
+ * thread are passed on to the handlers which were installed before ours.
+ */
+struct fault_handler {
+    static std::once_flag installed;
+    static std::uintptr_t page_size;
+    static struct sigaction previous_segv;
+    static struct sigaction previous_bus;
+
+    static auto install() -> void {
+        page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+        struct sigaction action {};
+        action.sa_sigaction = on_fault;
+        action.sa_flags     = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGSEGV, &action, &previous_segv);
+        ::sigaction(SIGBUS, &action, &previous_bus);
+    }
+
+    static auto on_fault(int sig, siginfo_t* info, void* context) -> void {
+        auto address = static_cast<std::uint8_t*>(info->si_addr);
+        auto guarded = guarded_memory;
+        if (guarded && address >= guarded->_base
+            && address < guarded->_base + memory::address_space
+                             + memory::guard_size) {
+            // Let the access complete on a fresh page, the loop running under
+            // guarded() notices the fault before the next instruction
+            auto page = reinterpret_cast<std::uintptr_t>(address)
+                        & ~(page_size - 1);
+            if (::mprotect(reinterpret_cast<void*>(page), page_size,
+                           PROT_READ | PROT_WRITE)
+                == 0) {
+                if (!guarded->_faulted.load(std::memory_order_relaxed)) {
+                    guarded->_fault_address =
+                        static_cast<std::uint64_t>(address - guarded->_base);
+                    guarded->_faulted.store(true, std::memory_order_relaxed);
+                }
+                return;
+            }
+        }
+        chain(sig, info, context);
+    }
+
+    static auto chain(int sig, siginfo_t* info, void* context) -> void {
+        auto& previous = sig == SIGBUS ? previous_bus : previous_segv;
+        if (previous.sa_flags & SA_SIGINFO) {
+            previous.sa_sigaction(sig, info, context);
+        } else if (previous.sa_handler != SIG_DFL
+                   && previous.sa_handler != SIG_IGN) {
+            previous.sa_handler(sig);
+        } else {
+            // Not our fault, so it must be a bug in the VM. Returning with the
+            // default action restored lets the faulting instruction crash us
+            // as usual.
+            ::signal(sig, SIG_DFL);
+        }
+    }
+};
+
+std::once_flag fault_handler::installed;
+std::uintptr_t fault_handler::page_size {0};
+struct sigaction fault_handler::previous_segv {};
+struct sigaction fault_handler::previous_bus {};
+
+static auto reservation_flags() noexcept -> int {
+    auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_NORESERVE)
+    flags |= MAP_NORESERVE;
+#endif
+    return flags;
+}
+
+memory::memory() {
+    auto base = ::mmap(nullptr, address_space + guard_size, PROT_NONE,
+                       reservation_flags(), -1, 0);
+    if (base == MAP_FAILED) {
+        throw memory_error {
+            std::string {"Could not reserve the address space of the linear "
+                         "memory: "}
+            + std::strerror(errno)};
+    }
+    _base = static_cast<std::uint8_t*>(base);
+}
+
+memory::~memory() noexcept {
+    ::munmap(_base, address_space + guard_size);
+}
+
+auto memory::commit(std::uint64_t size) -> void {
+    if (size != 0 && ::mprotect(_base, size, PROT_READ | PROT_WRITE) != 0) {
+        throw memory_error {
+            std::string {"Could not commit the linear memory: "}
+            + std::strerror(errno)};
+    }
+    _size = size;
+}
+
+auto memory::close_scratch_pages() noexcept -> void {
+    // Mapping the reservation again drops whatever was written to the pages
+    ::mmap(_base + _size, address_space + guard_size - _size, PROT_NONE,
+           reservation_flags() | MAP_FIXED, -1, 0);
+}
+
+auto memory::guarded(const std::function<void()>& body) -> void {
+    std::call_once(fault_handler::installed, fault_handler::install);
+    auto outer     = guarded_memory;
+    guarded_memory = this;
+    try {
+        body();
+    } catch (...) {
+        guarded_memory = outer;
+        if (faulted()) {
+            close_scratch_pages();
+            _faulted.store(false, std::memory_order_relaxed);
+        }
+        throw;
+    }
+    guarded_memory = outer;
+    if (faulted()) {
+        raise_fault();
+    }
+}
+
+}   // namespace reqvm
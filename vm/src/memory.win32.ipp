@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "memory.hpp"
+
+/*
+ * README:
+ *
+ * Please note that this is not a classical header file (and as such lacks a
+ * #pragma once directive) and is only meant to contain the Windows specific
+ * code of memory.
+ */
+
+#if !defined(REQVM_ON_WINDOWS)
+#    error "This file should only be used when compiling for MS Windows"
+#endif
+
+#if !defined(REQVM_IN_THE_MEMORY_CPP_FILE)
+#    error "This file should only be included by memory.cpp"
+#endif
+
+#include <mutex>
+#include <string>
+
+#ifndef NOMINMAX
+#    define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+namespace reqvm {
+
+// The memory guarded on this thread
+static thread_local memory* guarded_memory {nullptr};
+
+/*
+ * A vectored exception handler sees access violations before any frame based
+ * handler does, it is installed once and stays installed. Access violations
+ * outside of the memory guarded on the faulting thread continue the search for
+ * a handler.
+ */
+struct fault_handler {
+    static std::once_flag installed;
+
+    static auto install() -> void {
+        ::AddVectoredExceptionHandler(1, on_fault);
+    }
+
+    static auto CALLBACK on_fault(EXCEPTION_POINTERS* info) -> LONG {
+        auto record  = info->ExceptionRecord;
+        auto guarded = guarded_memory;
+        if (record->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || !guarded
+            || record->NumberParameters < 2) {
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+        auto address =
+            reinterpret_cast<std::uint8_t*>(record->ExceptionInformation[1]);
+        if (address < guarded->_base
+            || address >= guarded->_base + memory::address_space
+                              + memory::guard_size) {
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+        // Let the access complete on a fresh page, the loop running under
+        // guarded() notices the fault before the next instruction
+        if (!::VirtualAlloc(address, 1, MEM_COMMIT, PAGE_READWRITE)) {
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+        if (!guarded->_faulted.load(std::memory_order_relaxed)) {
+            guarded->_fault_address =
+                static_cast<std::uint64_t>(address - guarded->_base);
+            guarded->_faulted.store(true, std::memory_order_relaxed);
+        }
+        return EXCEPTION_CONTINUE_EXECUTION;
+    }
+};
+
+std::once_flag fault_handler::installed;
+
+memory::memory() {
+    _base = static_cast<std::uint8_t*>(::VirtualAlloc(
+        nullptr, address_space + guard_size, MEM_RESERVE, PAGE_NOACCESS));
+    if (not _base) {
+        throw memory_error {
+            "Could not reserve the address space of the linear memory: error "
+            + std::to_string(::GetLastError())};
+    }
+}
+
+memory::~memory() noexcept {
+    ::VirtualFree(_base, 0, MEM_RELEASE);
+}
+
+auto memory::commit(std::uint64_t size) -> void {
+    if (size != 0
+        && not ::VirtualAlloc(_base, size, MEM_COMMIT, PAGE_READWRITE)) {
+        throw memory_error {"Could not commit the linear memory: error "
+                            + std::to_string(::GetLastError())};
+    }
+    _size = size;
+}
+
+auto memory::close_scratch_pages() noexcept -> void {
+    // Decommitting drops whatever was written to the pages
+    ::VirtualFree(_base + _size, address_space + guard_size - _size,
+                  MEM_DECOMMIT);
+}
+
+auto memory::guarded(const std::function<void()>& body) -> void {
+    std::call_once(fault_handler::installed, fault_handler::install);
+    auto outer     = guarded_memory;
+    guarded_memory = this;
+    try {
+        body();
+    } catch (...) {
+        guarded_memory = outer;
+        if (faulted()) {
+            close_scratch_pages();
+            _faulted.store(false, std::memory_order_relaxed);
+        }
+        throw;
+    }
+    guarded_memory = outer;
+    if (faulted()) {
+        raise_fault();
+    }
+}
+
+}   // namespace reqvm
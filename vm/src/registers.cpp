@@ -29,7 +29,8 @@
 
 namespace reqvm {
 
-auto registers::parse_from_byte(std::uint8_t byte) -> registers::tag {
+auto registers::parse_other_from_byte(std::uint8_t byte)
+    -> registers::tag {
     const auto reg = static_cast<common::registers>(byte);
 
     if (reg == common::registers::sp) {
@@ -55,6 +56,14 @@ auto registers::parse_from_byte(std::uint8_t byte) -> registers::tag {
         return {registers::tag::kind::ifa,
                 byte - static_cast<std::uint8_t>(common::registers::ifa00)};
     }
+    if (common::registers::v00 <= reg && reg <= common::registers::v15) {
+        return {registers::tag::kind::vec,
+                byte - static_cast<std::uint8_t>(common::registers::v00)};
+    }
+    if (common::registers::fp00 <= reg && reg <= common::registers::fp15) {
+        return {registers::tag::kind::fp,
+                byte - static_cast<std::uint8_t>(common::registers::fp00)};
+    }
 #pragma GCC diagnostic pop
 
     throw invalid_register {"A byte that does not name a register was supplied "
@@ -62,7 +71,7 @@ auto registers::parse_from_byte(std::uint8_t byte) -> registers::tag {
                             static_cast<common::registers>(byte)};
 }
 
-auto registers::operator[](registers::tag tag) -> std::uint64_t& {
+auto registers::other(registers::tag tag) -> std::uint64_t& {
     switch (tag.kind) {
     case registers::tag::kind::pc:
         return _program_counter;
@@ -74,9 +83,43 @@ auto registers::operator[](registers::tag tag) -> std::uint64_t& {
         return _general_purpose[tag.idx];
     case registers::tag::kind::ifa:
         return _integer_functions_args[tag.idx];
+    case registers::tag::kind::vec:
+        throw invalid_register {"A vector register was supplied as operand to "
+                                "an opcode expecting a scalar register",
+                                static_cast<common::registers>(
+                                    tag.idx
+                                    + static_cast<std::uint8_t>(
+                                        common::registers::v00))};
+    case registers::tag::kind::fp:
+        throw invalid_register {"A floating point register was supplied as "
+                                "operand to an opcode expecting an integer "
+                                "register",
+                                static_cast<common::registers>(
+                                    tag.idx
+                                    + static_cast<std::uint8_t>(
+                                        common::registers::fp00))};
     default:
-        UNREACHABLE("register::operator[]: switch was not actually exhaustive");
+        UNREACHABLE("register::other: switch was not actually exhaustive");
+    }
+}
+
+auto registers::vector(registers::tag tag) -> vector_register& {
+    if (tag.kind != registers::tag::kind::vec) {
+        throw invalid_register {"A scalar register was supplied as operand to "
+                                "an opcode expecting a vector register",
+                                common::registers::none};
+    }
+    return _vectors[tag.idx];
+}
+
+auto registers::floating_point(registers::tag tag) -> double& {
+    if (tag.kind != registers::tag::kind::fp) {
+        throw invalid_register {"An integer register was supplied as operand "
+                                "to an opcode expecting a floating point "
+                                "register",
+                                common::registers::none};
     }
+    return _floating_points[tag.idx];
 }
 
 auto registers::is_error_on_lhs(registers::tag reg) noexcept -> bool {
@@ -31,6 +31,11 @@
 
 namespace reqvm {
 
+// A 256-bit vector register, its lanes are stored in little endian order
+struct alignas(32) vector_register {
+    std::uint8_t bytes[32];
+};
+
 class registers final {
 public:
     struct tag {
@@ -40,17 +45,35 @@ public:
             ire,
             gp,
             ifa,
+            vec,
+            fp,
         } kind;
         std::uint8_t idx;
     };
 
-    static auto parse_from_byte(std::uint8_t byte) -> tag;
+    // The general purpose registers are handled inline, as they are by far the
+    // most common operands
+    static auto parse_from_byte(std::uint8_t byte) -> tag {
+        constexpr auto gp00 =
+            static_cast<std::uint8_t>(common::registers::gp00);
+        if (static_cast<std::uint8_t>(byte - gp00) < 64) {
+            return {tag::kind::gp, static_cast<std::uint8_t>(byte - gp00)};
+        }
+        return parse_other_from_byte(byte);
+    }
     static auto is_error_on_lhs(tag reg) noexcept -> bool;
 
     registers() noexcept = default;
     ~registers() noexcept = default;
 
-    auto operator[](tag reg) -> std::uint64_t&;
+    auto operator[](tag reg) -> std::uint64_t& {
+        if (reg.kind == tag::kind::gp) {
+            return _general_purpose[reg.idx];
+        }
+        return other(reg);
+    }
+    auto vector(tag reg) -> vector_register&;
+    auto floating_point(tag reg) -> double&;
 
     auto general_purpose() noexcept -> std::array<std::uint64_t, 64>& {
         return _general_purpose;
@@ -78,8 +101,13 @@ public:
     }
 
 private:
+    static auto parse_other_from_byte(std::uint8_t byte) -> tag;
+    auto other(tag reg) -> std::uint64_t&;
+
     std::array<std::uint64_t, 64> _general_purpose {0};
     std::array<std::uint64_t, 16> _integer_functions_args {0};
+    std::array<vector_register, 16> _vectors {};
+    std::array<double, 16> _floating_points {};
     std::uint64_t _program_counter {0};
     std::uint64_t _stack_pointer {0};
     std::uint64_t _integer_return {0};
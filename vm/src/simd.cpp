@@ -0,0 +1,395 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "simd.hpp"
+
+#include "exceptions.hpp"
+#include "utility.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define REQVM_HAS_X86_KERNELS 1
+#    include <immintrin.h>
+#endif
+
+namespace reqvm {
+namespace simd {
+
+common::vec_op parse_from_byte(std::uint8_t byte) {
+    if ((byte >= 0x10 && byte <= 0x33) || (byte >= 0x40 && byte <= 0x42)
+        || byte == 0x50 || byte == 0x51) {
+        return static_cast<common::vec_op>(byte);
+    }
+    throw bad_argument {"Unknown operation passed as argument to 'vec': "
+                        + std::to_string(byte)};
+}
+
+/*
+ * Plain C++ kernels, used when the host has no vector instructions we know
+ * about, and for the operations said instructions don't cover.
+ */
+
+template <typename T>
+static auto get_lane(const vector_register& reg, std::size_t i) noexcept -> T {
+    T val;
+    std::memcpy(&val, reg.bytes + i * sizeof(T), sizeof(T));
+    return from_little_endian(val);
+}
+
+template <typename T>
+static auto set_lane(vector_register& reg, std::size_t i, T val) noexcept
+    -> void {
+    val = from_little_endian(val);
+    std::memcpy(reg.bytes + i * sizeof(T), &val, sizeof(T));
+}
+
+template <typename T, typename Op>
+static auto lanewise(vector_register& lhs,
+                     const vector_register& rhs,
+                     Op op) noexcept -> void {
+    for (std::size_t i = 0; i < sizeof(vector_register) / sizeof(T); i++) {
+        set_lane<T>(
+            lhs, i,
+            static_cast<T>(op(get_lane<T>(lhs, i), get_lane<T>(rhs, i))));
+    }
+}
+
+template <typename T>
+static auto scalar_add(vector_register& lhs,
+                       const vector_register& rhs) noexcept -> void {
+    lanewise<T>(lhs, rhs, [](T a, T b) { return a + b; });
+}
+
+template <typename T>
+static auto scalar_sub(vector_register& lhs,
+                       const vector_register& rhs) noexcept -> void {
+    lanewise<T>(lhs, rhs, [](T a, T b) { return a - b; });
+}
+
+template <typename T>
+static auto scalar_mul(vector_register& lhs,
+                       const vector_register& rhs) noexcept -> void {
+    // Lanes narrower than int would be promoted to it, and their product could
+    // overflow it
+    using wide =
+        std::conditional_t<(sizeof(T) < sizeof(unsigned)), unsigned, T>;
+    lanewise<T>(lhs, rhs, [](T a, T b) {
+        return static_cast<T>(static_cast<wide>(a) * static_cast<wide>(b));
+    });
+}
+
+template <typename T>
+static auto scalar_cmpeq(vector_register& lhs,
+                         const vector_register& rhs) noexcept -> void {
+    lanewise<T>(lhs, rhs, [](T a, T b) { return a == b ? ~T {0} : T {0}; });
+}
+
+template <typename T>
+static auto scalar_cmpgt(vector_register& lhs,
+                         const vector_register& rhs) noexcept -> void {
+    lanewise<T>(lhs, rhs, [](T a, T b) { return a > b ? ~T {0} : T {0}; });
+}
+
+// Shifting by the width of the lanes or more clears them, like the vector
+// instructions do
+template <typename T>
+static auto scalar_shl(vector_register& lhs, std::uint64_t count) noexcept
+    -> void {
+    lanewise<T>(lhs, lhs, [count](T a, T) {
+        return count >= sizeof(T) * 8 ? T {0} : static_cast<T>(a << count);
+    });
+}
+
+template <typename T>
+static auto scalar_shr(vector_register& lhs, std::uint64_t count) noexcept
+    -> void {
+    lanewise<T>(lhs, lhs, [count](T a, T) {
+        return count >= sizeof(T) * 8 ? T {0} : static_cast<T>(a >> count);
+    });
+}
+
+static auto scalar_and(vector_register& lhs,
+                       const vector_register& rhs) noexcept -> void {
+    lanewise<std::uint64_t>(
+        lhs, rhs, [](std::uint64_t a, std::uint64_t b) { return a & b; });
+}
+
+static auto scalar_or(vector_register& lhs,
+                      const vector_register& rhs) noexcept -> void {
+    lanewise<std::uint64_t>(
+        lhs, rhs, [](std::uint64_t a, std::uint64_t b) { return a | b; });
+}
+
+static auto scalar_xor(vector_register& lhs,
+                       const vector_register& rhs) noexcept -> void {
+    lanewise<std::uint64_t>(
+        lhs, rhs, [](std::uint64_t a, std::uint64_t b) { return a ^ b; });
+}
+
+static const kernels scalar_kernels {
+    "scalar",
+    {scalar_add<std::uint8_t>, scalar_add<std::uint16_t>,
+     scalar_add<std::uint32_t>, scalar_add<std::uint64_t>},
+    {scalar_sub<std::uint8_t>, scalar_sub<std::uint16_t>,
+     scalar_sub<std::uint32_t>, scalar_sub<std::uint64_t>},
+    {scalar_mul<std::uint8_t>, scalar_mul<std::uint16_t>,
+     scalar_mul<std::uint32_t>, scalar_mul<std::uint64_t>},
+    {scalar_shl<std::uint8_t>, scalar_shl<std::uint16_t>,
+     scalar_shl<std::uint32_t>, scalar_shl<std::uint64_t>},
+    {scalar_shr<std::uint8_t>, scalar_shr<std::uint16_t>,
+     scalar_shr<std::uint32_t>, scalar_shr<std::uint64_t>},
+    {scalar_cmpeq<std::uint8_t>, scalar_cmpeq<std::uint16_t>,
+     scalar_cmpeq<std::uint32_t>, scalar_cmpeq<std::uint64_t>},
+    {scalar_cmpgt<std::uint8_t>, scalar_cmpgt<std::uint16_t>,
+     scalar_cmpgt<std::uint32_t>, scalar_cmpgt<std::uint64_t>},
+    scalar_and,
+    scalar_or,
+    scalar_xor,
+};
+
+#if defined(REQVM_HAS_X86_KERNELS)
+
+/*
+ * SSE2 kernels, which work on the two halves of a register separately.
+ *
+ * The target attributes let us use the intrinsics without compiling the whole
+ * VM for a specific CPU, select_kernels() makes sure they're only picked when
+ * the host supports them.
+ */
+
+#    define SSE2_BINARY_KERNEL(name, expr)                                     \
+        __attribute__((target("sse2"))) static auto name(                     \
+            vector_register& lhs, const vector_register& rhs) noexcept->void { \
+            for (int i = 0; i < 2; i++) {                                      \
+                auto a = _mm_load_si128(                                       \
+                    reinterpret_cast<const __m128i*>(lhs.bytes) + i);          \
+                auto b = _mm_load_si128(                                       \
+                    reinterpret_cast<const __m128i*>(rhs.bytes) + i);          \
+                _mm_store_si128(reinterpret_cast<__m128i*>(lhs.bytes) + i,     \
+                                (expr));                                       \
+            }                                                                  \
+        }
+
+#    define SSE2_SHIFT_KERNEL(name, intrinsic)                                 \
+        __attribute__((target("sse2"))) static auto name(                     \
+            vector_register& lhs, std::uint64_t count) noexcept->void {        \
+            auto c = _mm_set_epi64x(0, static_cast<long long>(count));         \
+            for (int i = 0; i < 2; i++) {                                      \
+                auto p = reinterpret_cast<__m128i*>(lhs.bytes) + i;            \
+                _mm_store_si128(p, intrinsic(_mm_load_si128(p), c));           \
+            }                                                                  \
+        }
+
+// SSE2 only has signed comparisons, flipping the sign bits first turns them
+// into unsigned ones
+#    define SSE2_UNSIGNED_CMPGT(bits, set1, min)                               \
+        _mm_cmpgt_epi##bits(_mm_xor_si128(a, set1(min)),                       \
+                            _mm_xor_si128(b, set1(min)))
+
+SSE2_BINARY_KERNEL(sse2_add8, _mm_add_epi8(a, b))
+SSE2_BINARY_KERNEL(sse2_add16, _mm_add_epi16(a, b))
+SSE2_BINARY_KERNEL(sse2_add32, _mm_add_epi32(a, b))
+SSE2_BINARY_KERNEL(sse2_add64, _mm_add_epi64(a, b))
+SSE2_BINARY_KERNEL(sse2_sub8, _mm_sub_epi8(a, b))
+SSE2_BINARY_KERNEL(sse2_sub16, _mm_sub_epi16(a, b))
+SSE2_BINARY_KERNEL(sse2_sub32, _mm_sub_epi32(a, b))
+SSE2_BINARY_KERNEL(sse2_sub64, _mm_sub_epi64(a, b))
+SSE2_BINARY_KERNEL(sse2_mul16, _mm_mullo_epi16(a, b))
+SSE2_BINARY_KERNEL(sse2_cmpeq8, _mm_cmpeq_epi8(a, b))
+SSE2_BINARY_KERNEL(sse2_cmpeq16, _mm_cmpeq_epi16(a, b))
+SSE2_BINARY_KERNEL(sse2_cmpeq32, _mm_cmpeq_epi32(a, b))
+SSE2_BINARY_KERNEL(sse2_cmpgt8,
+                   SSE2_UNSIGNED_CMPGT(8, _mm_set1_epi8, INT8_MIN))
+SSE2_BINARY_KERNEL(sse2_cmpgt16,
+                   SSE2_UNSIGNED_CMPGT(16, _mm_set1_epi16, INT16_MIN))
+SSE2_BINARY_KERNEL(sse2_cmpgt32,
+                   SSE2_UNSIGNED_CMPGT(32, _mm_set1_epi32, INT32_MIN))
+SSE2_BINARY_KERNEL(sse2_and, _mm_and_si128(a, b))
+SSE2_BINARY_KERNEL(sse2_or, _mm_or_si128(a, b))
+SSE2_BINARY_KERNEL(sse2_xor, _mm_xor_si128(a, b))
+SSE2_SHIFT_KERNEL(sse2_shl16, _mm_sll_epi16)
+SSE2_SHIFT_KERNEL(sse2_shl32, _mm_sll_epi32)
+SSE2_SHIFT_KERNEL(sse2_shl64, _mm_sll_epi64)
+SSE2_SHIFT_KERNEL(sse2_shr16, _mm_srl_epi16)
+SSE2_SHIFT_KERNEL(sse2_shr32, _mm_srl_epi32)
+SSE2_SHIFT_KERNEL(sse2_shr64, _mm_srl_epi64)
+
+// There are no SSE2 instructions for 8-bit multiplications and shifts, 32 and
+// 64-bit multiplications, and 64-bit comparisons
+static const kernels sse2_kernels {
+    "SSE2",
+    {sse2_add8, sse2_add16, sse2_add32, sse2_add64},
+    {sse2_sub8, sse2_sub16, sse2_sub32, sse2_sub64},
+    {scalar_mul<std::uint8_t>, sse2_mul16, scalar_mul<std::uint32_t>,
+     scalar_mul<std::uint64_t>},
+    {scalar_shl<std::uint8_t>, sse2_shl16, sse2_shl32, sse2_shl64},
+    {scalar_shr<std::uint8_t>, sse2_shr16, sse2_shr32, sse2_shr64},
+    {sse2_cmpeq8, sse2_cmpeq16, sse2_cmpeq32, scalar_cmpeq<std::uint64_t>},
+    {sse2_cmpgt8, sse2_cmpgt16, sse2_cmpgt32, scalar_cmpgt<std::uint64_t>},
+    sse2_and,
+    sse2_or,
+    sse2_xor,
+};
+
+/*
+ * AVX2 kernels, which work on the whole register at once.
+ */
+
+#    define AVX2_BINARY_KERNEL(name, expr)                                     \
+        __attribute__((target("avx2"))) static auto name(                     \
+            vector_register& lhs, const vector_register& rhs) noexcept->void { \
+            auto a = _mm256_load_si256(                                        \
+                reinterpret_cast<const __m256i*>(lhs.bytes));                  \
+            auto b = _mm256_load_si256(                                        \
+                reinterpret_cast<const __m256i*>(rhs.bytes));                  \
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lhs.bytes), (expr)); \
+        }
+
+#    define AVX2_SHIFT_KERNEL(name, intrinsic)                                 \
+        __attribute__((target("avx2"))) static auto name(                     \
+            vector_register& lhs, std::uint64_t count) noexcept->void {        \
+            auto p = reinterpret_cast<__m256i*>(lhs.bytes);                    \
+            _mm256_store_si256(                                                \
+                p, intrinsic(_mm256_load_si256(p),                             \
+                             _mm_set_epi64x(0, static_cast<long long>(count)))); \
+        }
+
+#    define AVX2_UNSIGNED_CMPGT(bits, set1, min)                               \
+        _mm256_cmpgt_epi##bits(_mm256_xor_si256(a, set1(min)),                 \
+                               _mm256_xor_si256(b, set1(min)))
+
+AVX2_BINARY_KERNEL(avx2_add8, _mm256_add_epi8(a, b))
+AVX2_BINARY_KERNEL(avx2_add16, _mm256_add_epi16(a, b))
+AVX2_BINARY_KERNEL(avx2_add32, _mm256_add_epi32(a, b))
+AVX2_BINARY_KERNEL(avx2_add64, _mm256_add_epi64(a, b))
+AVX2_BINARY_KERNEL(avx2_sub8, _mm256_sub_epi8(a, b))
+AVX2_BINARY_KERNEL(avx2_sub16, _mm256_sub_epi16(a, b))
+AVX2_BINARY_KERNEL(avx2_sub32, _mm256_sub_epi32(a, b))
+AVX2_BINARY_KERNEL(avx2_sub64, _mm256_sub_epi64(a, b))
+AVX2_BINARY_KERNEL(avx2_mul16, _mm256_mullo_epi16(a, b))
+AVX2_BINARY_KERNEL(avx2_mul32, _mm256_mullo_epi32(a, b))
+AVX2_BINARY_KERNEL(avx2_cmpeq8, _mm256_cmpeq_epi8(a, b))
+AVX2_BINARY_KERNEL(avx2_cmpeq16, _mm256_cmpeq_epi16(a, b))
+AVX2_BINARY_KERNEL(avx2_cmpeq32, _mm256_cmpeq_epi32(a, b))
+AVX2_BINARY_KERNEL(avx2_cmpeq64, _mm256_cmpeq_epi64(a, b))
+AVX2_BINARY_KERNEL(avx2_cmpgt8,
+                   AVX2_UNSIGNED_CMPGT(8, _mm256_set1_epi8, INT8_MIN))
+AVX2_BINARY_KERNEL(avx2_cmpgt16,
+                   AVX2_UNSIGNED_CMPGT(16, _mm256_set1_epi16, INT16_MIN))
+AVX2_BINARY_KERNEL(avx2_cmpgt32,
+                   AVX2_UNSIGNED_CMPGT(32, _mm256_set1_epi32, INT32_MIN))
+AVX2_BINARY_KERNEL(avx2_cmpgt64,
+                   AVX2_UNSIGNED_CMPGT(64, _mm256_set1_epi64x, INT64_MIN))
+AVX2_BINARY_KERNEL(avx2_and, _mm256_and_si256(a, b))
+AVX2_BINARY_KERNEL(avx2_or, _mm256_or_si256(a, b))
+AVX2_BINARY_KERNEL(avx2_xor, _mm256_xor_si256(a, b))
+AVX2_SHIFT_KERNEL(avx2_shl16, _mm256_sll_epi16)
+AVX2_SHIFT_KERNEL(avx2_shl32, _mm256_sll_epi32)
+AVX2_SHIFT_KERNEL(avx2_shl64, _mm256_sll_epi64)
+AVX2_SHIFT_KERNEL(avx2_shr16, _mm256_srl_epi16)
+AVX2_SHIFT_KERNEL(avx2_shr32, _mm256_srl_epi32)
+AVX2_SHIFT_KERNEL(avx2_shr64, _mm256_srl_epi64)
+
+// There are no AVX2 instructions for 8-bit multiplications and shifts, and
+// 64-bit multiplications
+static const kernels avx2_kernels {
+    "AVX2",
+    {avx2_add8, avx2_add16, avx2_add32, avx2_add64},
+    {avx2_sub8, avx2_sub16, avx2_sub32, avx2_sub64},
+    {scalar_mul<std::uint8_t>, avx2_mul16, avx2_mul32,
+     scalar_mul<std::uint64_t>},
+    {scalar_shl<std::uint8_t>, avx2_shl16, avx2_shl32, avx2_shl64},
+    {scalar_shr<std::uint8_t>, avx2_shr16, avx2_shr32, avx2_shr64},
+    {avx2_cmpeq8, avx2_cmpeq16, avx2_cmpeq32, avx2_cmpeq64},
+    {avx2_cmpgt8, avx2_cmpgt16, avx2_cmpgt32, avx2_cmpgt64},
+    avx2_and,
+    avx2_or,
+    avx2_xor,
+};
+
+#    undef SSE2_BINARY_KERNEL
+#    undef SSE2_SHIFT_KERNEL
+#    undef SSE2_UNSIGNED_CMPGT
+#    undef AVX2_BINARY_KERNEL
+#    undef AVX2_SHIFT_KERNEL
+#    undef AVX2_UNSIGNED_CMPGT
+
+#endif
+
+auto select_kernels() noexcept -> const kernels& {
+#if defined(REQVM_HAS_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return avx2_kernels;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return sse2_kernels;
+    }
+#endif
+    return scalar_kernels;
+}
+
+auto broadcast(vector_register& dst, std::uint64_t val, std::uint8_t width)
+    -> void {
+    for (std::size_t i = 0; i < sizeof(vector_register); i += 1u << width) {
+        for (std::size_t j = 0; j < 1u << width; j++) {
+            dst.bytes[i + j] = static_cast<std::uint8_t>(val >> (8 * j));
+        }
+    }
+}
+
+auto horizontal_sum(const vector_register& src, std::uint8_t width)
+    -> std::uint64_t {
+    std::uint64_t sum {0};
+    switch (width) {
+    case 0:
+        for (std::size_t i = 0; i < 32; i++) {
+            sum += get_lane<std::uint8_t>(src, i);
+        }
+        break;
+    case 1:
+        for (std::size_t i = 0; i < 16; i++) {
+            sum += get_lane<std::uint16_t>(src, i);
+        }
+        break;
+    case 2:
+        for (std::size_t i = 0; i < 8; i++) {
+            sum += get_lane<std::uint32_t>(src, i);
+        }
+        break;
+    case 3:
+        for (std::size_t i = 0; i < 4; i++) {
+            sum += get_lane<std::uint64_t>(src, i);
+        }
+        break;
+    }
+    return sum;
+}
+
+}   // namespace simd
+}   // namespace reqvm
@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../../common/opcodes.hpp"
+#include "registers.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace reqvm {
+namespace simd {
+
+common::vec_op parse_from_byte(std::uint8_t byte);
+
+// Strips the lane width from a lane-wise operation
+inline auto family_of(common::vec_op op) noexcept -> common::vec_op {
+    auto byte = static_cast<std::uint8_t>(op);
+    return byte < 0x40 ? static_cast<common::vec_op>(byte & ~0b11) : op;
+}
+
+inline auto lane_width_of(common::vec_op op) noexcept -> std::uint8_t {
+    return static_cast<std::uint8_t>(op) & 0b11;
+}
+
+using binary_kernel = void (*)(vector_register& lhs,
+                               const vector_register& rhs) noexcept;
+using shift_kernel  = void (*)(vector_register& lhs,
+                              std::uint64_t count) noexcept;
+
+/*
+ * The implementations of the lane-wise operations, the arrays are indexed by
+ * the lane width as returned by lane_width_of.
+ *
+ * Comparisons set the lanes for which they are true to all ones, and the others
+ * to zero. `cmpgt` compares the lanes as unsigned numbers.
+ */
+struct kernels {
+    const char* name;
+    std::array<binary_kernel, 4> add;
+    std::array<binary_kernel, 4> sub;
+    std::array<binary_kernel, 4> mul;
+    std::array<shift_kernel, 4> shl;
+    std::array<shift_kernel, 4> shr;
+    std::array<binary_kernel, 4> cmpeq;
+    std::array<binary_kernel, 4> cmpgt;
+    binary_kernel and_;
+    binary_kernel or_;
+    binary_kernel xor_;
+};
+
+// Picks the best kernels the host CPU supports (AVX2, SSE2 or plain C++)
+auto select_kernels() noexcept -> const kernels&;
+
+auto broadcast(vector_register& dst, std::uint64_t val, std::uint8_t width)
+    -> void;
+auto horizontal_sum(const vector_register& src, std::uint8_t width)
+    -> std::uint64_t;
+
+}   // namespace simd
+}   // namespace reqvm
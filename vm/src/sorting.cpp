@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mitca Dumitru
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sorting.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace reqvm {
+namespace sorting {
+
+static auto key_of(std::uint64_t key) noexcept -> std::uint64_t {
+    return key;
+}
+
+static auto key_of(const pair& the_pair) noexcept -> std::uint64_t {
+    return the_pair.key;
+}
+
+// Below this many elements, building the histograms costs more than it saves
+static constexpr std::size_t radix_threshold = 256;
+
+/*
+ * A least significant digit radix sort with 8-bit digits. The histograms of
+ * all the digits are built in a single pass over the data, and the passes for
+ * digits all the keys share (e.g. the upper bytes of small keys) are skipped.
+ */
+template <typename T>
+static auto radix_sort(T* data, std::size_t count) -> void {
+    if (count < radix_threshold) {
+        std::stable_sort(data, data + count, [](const T& lhs, const T& rhs) {
+            return key_of(lhs) < key_of(rhs);
+        });
+        return;
+    }
+    std::array<std::array<std::size_t, 256>, 8> counts {};
+    for (std::size_t i = 0; i < count; i++) {
+        auto key = key_of(data[i]);
+        for (auto& digit_counts : counts) {
+            digit_counts[key & 0xff]++;
+            key >>= 8;
+        }
+    }
+    std::vector<T> scratch(count);
+    auto from = data;
+    auto to   = scratch.data();
+    for (std::size_t digit = 0; digit < counts.size(); digit++) {
+        auto& offsets = counts[digit];
+        auto shift    = digit * 8;
+        if (offsets[(key_of(from[0]) >> shift) & 0xff] == count) {
+            continue;
+        }
+        std::size_t offset {0};
+        for (auto& slot : offsets) {
+            auto digit_count = slot;
+            slot             = offset;
+            offset += digit_count;
+        }
+        for (std::size_t i = 0; i < count; i++) {
+            to[offsets[(key_of(from[i]) >> shift) & 0xff]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::copy(from, from + count, data);
+    }
+}
+
+auto sort(std::uint64_t* keys, std::size_t count) -> void {
+    radix_sort(keys, count);
+}
+
+auto sort(pair* pairs, std::size_t count) -> void {
+    radix_sort(pairs, count);
+}
+
+}   // namespace sorting
+}   // namespace reqvm
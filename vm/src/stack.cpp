@@ -24,10 +24,14 @@
 
 #include "stack.hpp"
 
+#include "bits.hpp"
+
+#include <cstring>
+
 namespace reqvm {
 
 auto stack::push(std::uint64_t val, registers& regs) -> void {
-    if (regs.sp() + 1 > (1024 * 1024)) {
+    if (regs.sp() + 1 > capacity) {
         throw stack_error {
             "Stack overflow: the binary has tried writing past the end of the "
             "stack."};
@@ -41,8 +45,84 @@ auto stack::pop(registers& regs) -> std::uint64_t {
             "Stack underflow: the binary has tried reading before the start "
             "of the stack."};
     }
-    regs.sp()--;
-    return _storage[regs.sp() + 1];
+    return _storage[--regs.sp()];
+}
+
+/*
+ * Registers selected by a mask usually come in runs (e.g. gp00..gp07), so we
+ * copy whole runs at once instead of a register at a time.
+ */
+template <typename CopyRun>
+static auto for_each_run(std::uint64_t mask, CopyRun copy_run) -> void {
+    std::uint64_t copied {0};
+    while (mask != 0) {
+        auto first  = bits::count_trailing_zeros(mask);
+        auto length = bits::count_trailing_zeros(~(mask >> first));
+        copy_run(first, copied, length);
+        copied += length;
+        // Adding the lowest set bit carries through, and clears, the run
+        mask &= mask + (mask & (~mask + 1));
+    }
+}
+
+auto stack::push_many(std::uint64_t mask, registers& regs) -> void {
+    const auto count = bits::popcount(mask);
+    if (regs.sp() + count > capacity) {
+        throw stack_error {
+            "Stack overflow: the binary has tried writing past the end of the "
+            "stack."};
+    }
+    const auto* gp  = regs.general_purpose().data();
+    auto* const top = _storage + regs.sp();
+    for_each_run(mask, [&](std::uint64_t first, std::uint64_t copied,
+                           std::uint64_t length) {
+        std::memcpy(top + copied, gp + first, length * sizeof(std::uint64_t));
+    });
+    regs.sp() += count;
+}
+
+auto stack::pop_many(std::uint64_t mask, registers& regs) -> void {
+    const auto count = bits::popcount(mask);
+    if (regs.sp() < count) {
+        throw stack_error {
+            "Stack underflow: the binary has tried reading before the start "
+            "of the stack."};
+    }
+    regs.sp() -= count;
+    auto* gp              = regs.general_purpose().data();
+    const auto* const top = _storage + regs.sp();
+    for_each_run(mask, [&](std::uint64_t first, std::uint64_t copied,
+                           std::uint64_t length) {
+        std::memcpy(gp + first, top + copied, length * sizeof(std::uint64_t));
+    });
+}
+
+auto stack::slot(std::uint64_t offset, registers& regs) -> std::uint64_t& {
+    if (offset >= regs.sp()) {
+        throw stack_error {
+            "Stack underflow: the binary has tried accessing a slot below the "
+            "start of the stack."};
+    }
+    return _storage[regs.sp() - 1 - offset];
+}
+
+auto stack::reserve(std::uint64_t count, registers& regs) -> void {
+    if (count > capacity - regs.sp()) {
+        throw stack_error {
+            "Stack overflow: the binary has tried reserving slots past the end "
+            "of the stack."};
+    }
+    std::memset(_storage + regs.sp(), 0, count * sizeof(std::uint64_t));
+    regs.sp() += count;
+}
+
+auto stack::release(std::uint64_t count, registers& regs) -> void {
+    if (count > regs.sp()) {
+        throw stack_error {
+            "Stack underflow: the binary has tried releasing more slots than "
+            "there are on the stack."};
+    }
+    regs.sp() -= count;
 }
 
 }   // namespace reqvm
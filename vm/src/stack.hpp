@@ -27,6 +27,7 @@
 #include "registers.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 namespace reqvm {
@@ -40,7 +41,9 @@ public:
 
 class stack final {
 public:
-    stack() : _storage {new std::uint64_t[1024 * 1024]} {}
+    static constexpr std::uint64_t capacity = 1024 * 1024;
+
+    stack() : _storage {new std::uint64_t[capacity]} {}
     ~stack() noexcept {
         delete[] _storage;
     }
@@ -48,6 +51,26 @@ public:
     auto push(std::uint64_t val, registers& regs) -> void;
     auto pop(registers& regs) -> std::uint64_t;
 
+    // Push and pop the general purpose registers selected by `mask`, in
+    // ascending order, so a pop_many with the same mask undoes a push_many
+    auto push_many(std::uint64_t mask, registers& regs) -> void;
+    auto pop_many(std::uint64_t mask, registers& regs) -> void;
+
+    // Returns the slot `offset` entries below the top of the stack, 0 being the
+    // top itself
+    auto slot(std::uint64_t offset, registers& regs) -> std::uint64_t&;
+    // Reserve (zeroed) and release `count` slots at once
+    auto reserve(std::uint64_t count, registers& regs) -> void;
+    auto release(std::uint64_t count, registers& regs) -> void;
+
+    // Stores `count` entries the VM kept out of the stack into the slots
+    // starting at `depth`, which must be below sp
+    auto write_back(std::uint64_t depth,
+                    const std::uint64_t* vals,
+                    std::uint64_t count) noexcept -> void {
+        std::memcpy(_storage + depth, vals, count * sizeof(std::uint64_t));
+    }
+
 private:
     std::uint64_t* _storage;
 };
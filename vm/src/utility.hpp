@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #define REQVM_MAKE_NONCOPYABLE(type)                                           \
 public:                                                                        \
     type(const type&) = delete;                                                \
@@ -33,3 +35,23 @@ public:                                                                        \
 public:                                                                        \
     type(type&&) = delete;                                                     \
     auto operator=(type &&)->type& = delete;
+
+namespace reqvm {
+
+// Data the binary works on (memory, mapped input, ...) is little endian, so
+// this is a no-op on most hosts
+template <typename T>
+inline auto from_little_endian(T val) noexcept -> T {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    if constexpr (sizeof(T) == 2) {
+        return __builtin_bswap16(val);
+    } else if constexpr (sizeof(T) == 4) {
+        return __builtin_bswap32(val);
+    } else if constexpr (sizeof(T) == 8) {
+        return __builtin_bswap64(val);
+    }
+#endif
+    return val;
+}
+
+}   // namespace reqvm
@@ -25,43 +25,317 @@
 #include "vm.hpp"
 
 #include "../../common/preamble.hpp"
+#include "../../common/unreachable.hpp"
 #include "exceptions.hpp"
 #include "io.hpp"
 
 #include <array>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <optional>
 
 static inline auto is_version_compatible(std::uint16_t major,
                                          std::uint16_t minor,
                                          std::uint16_t patch) noexcept -> bool {
     using namespace common;
-    if (major <= version::major) {
-        return true;
+    // Versions are ordered by their major, then minor, then patch numbers
+    if (major != version::major) {
+        return major < version::major;
     }
-    if (minor <= version::minor) {
-        return true;
+    if (minor != version::minor) {
+        return minor < version::minor;
     }
-    if (patch <= version::patch) {
-        return true;
+    return patch <= version::patch;
+}
+
+// Returns the length in bytes of an instruction starting with `op`, or 0 if
+// `op` is not a valid opcode. For jump tables this is only the length of the
+// part preceding the targets
+static auto instruction_size(common::opcode op) noexcept -> std::uint64_t {
+    using common::opcode;
+    switch (op) {
+    case opcode::noop:
+    case opcode::ret:
+    case opcode::halt:
+        return 1;
+    case opcode::not_:
+    case opcode::push:
+    case opcode::pop:
+    case opcode::insize:
+    case opcode::jmpr:
+    case opcode::callr:
+    case opcode::free:
+    case opcode::htnew:
+    case opcode::fclose:
+        return 2;
+    case opcode::io:
+    case opcode::add:
+    case opcode::sub:
+    case opcode::mul:
+    case opcode::div:
+    case opcode::mod:
+    case opcode::and_:
+    case opcode::or_:
+    case opcode::xor_:
+    case opcode::lshft:
+    case opcode::rshft:
+    case opcode::cmp:
+    case opcode::mov:
+    case opcode::load8:
+    case opcode::load16:
+    case opcode::load32:
+    case opcode::load64:
+    case opcode::store8:
+    case opcode::store16:
+    case opcode::store32:
+    case opcode::store64:
+    case opcode::inload8:
+    case opcode::inload16:
+    case opcode::inload32:
+    case opcode::inload64:
+    case opcode::popcnt:
+    case opcode::clz:
+    case opcode::ctz:
+    case opcode::bswap:
+    case opcode::rotl:
+    case opcode::rotr:
+    case opcode::crc32:
+    case opcode::adc:
+    case opcode::sbb:
+    case opcode::fmov:
+    case opcode::fadd:
+    case opcode::fsub:
+    case opcode::fmul:
+    case opcode::fdiv:
+    case opcode::fsqrt:
+    case opcode::fcmp:
+    case opcode::cvtif:
+    case opcode::cvtfi:
+    case opcode::movif:
+    case opcode::movfi:
+    case opcode::alloc:
+    case opcode::htdel:
+    case opcode::sort:
+    case opcode::sortkv:
+    case opcode::dload8:
+    case opcode::dload16:
+    case opcode::dload32:
+    case opcode::dload64:
+    case opcode::fseek:
+        return 3;
+    case opcode::add3:
+    case opcode::sub3:
+    case opcode::mul3:
+    case opcode::div3:
+    case opcode::mod3:
+    case opcode::and3:
+    case opcode::or3:
+    case opcode::xor3:
+    case opcode::lshft3:
+    case opcode::rshft3:
+    case opcode::vec:
+    case opcode::mcpy:
+    case opcode::mset:
+    case opcode::mcmp:
+    case opcode::mchr:
+    case opcode::mulx:
+    case opcode::divmod:
+    case opcode::cmov:
+    case opcode::fma:
+    case opcode::htput:
+    case opcode::htget:
+    case opcode::bsearch:
+    case opcode::dcpy:
+    case opcode::fopen:
+    case opcode::fread:
+    case opcode::fwrite:
+        return 4;
+    case opcode::csel:
+        return 5;
+    case opcode::call:
+    case opcode::pushc:
+    case opcode::jmp:
+    case opcode::jeq:
+    case opcode::jneq:
+    case opcode::jl:
+    case opcode::jleq:
+    case opcode::jg:
+    case opcode::jgeq:
+    case opcode::callnative:
+    case opcode::tcall:
+    case opcode::pushm:
+    case opcode::popm:
+    case opcode::enter:
+    case opcode::leave:
+        return 9;
+    case opcode::movi:
+    case opcode::addi:
+    case opcode::subi:
+    case opcode::muli:
+    case opcode::andi:
+    case opcode::ori:
+    case opcode::xori:
+    case opcode::shli:
+    case opcode::shri:
+    case opcode::cmpi:
+    case opcode::jtab:
+    case opcode::loop:
+    case opcode::ldsp:
+    case opcode::stsp:
+    case opcode::fmovi:
+        return 10;
     }
-    return false;
+    return 0;
 }
 
 namespace reqvm {
 
-vm::vm(const std::string& binary) {
+// Returns a mask of all ones if `condition` holds for `flag`, or all zeroes
+// otherwise, so that selecting a value does not need a branch
+static auto condition_mask(std::uint8_t condition, const flags& flag)
+    -> std::uint64_t {
+    switch (static_cast<common::condition>(condition)) {
+    case common::condition::eq:
+    case common::condition::neq:
+    case common::condition::l:
+    case common::condition::leq:
+    case common::condition::g:
+    case common::condition::geq:
+        return -static_cast<std::uint64_t>((condition >> flag.cmp_flag) & 1);
+    }
+    throw bad_argument {"Unknown condition " + std::to_string(condition)
+                        + " passed as argument to a conditional move."};
+}
+
+vm::vm(const std::string& binary)
+    : _simd {&simd::select_kernels()}
+    , _crc32c {bits::select_crc32c()}
+    , _fma {fp::select_fma()} {
     auto path = std::filesystem::path {binary};
     _binary   = load_from(path);
 }
 
+auto vm::map_input(const std::string& input) -> void {
+    _input = std::make_unique<mmf_backed_binary_manager>(fs::path {input});
+}
+
+auto vm::register_native(native_function function) -> std::uint64_t {
+    _natives.push_back(function);
+    return _natives.size() - 1;
+}
+
+auto vm::hash_table_at(std::uint64_t handle) -> hash_table& {
+    if (handle >= _hash_tables.size()) {
+        throw bad_argument {"The binary has tried to use hash table "
+                            + std::to_string(handle) + ", but only "
+                            + std::to_string(_hash_tables.size())
+                            + " have been created."};
+    }
+    return _hash_tables[handle];
+}
+
 auto vm::run() -> int {
     read_preamble();
-    while (_regs.pc() <= _binary->size() && !_halted) {
-        cycle(static_cast<common::opcode>((*_binary)[_regs.pc()]));
-    }
+    find_instruction_boundaries();
+    _memory.guarded([this] {
+        if (_cache_stack_top) {
+            run_caching_stack_top();
+            return;
+        }
+        while (_regs.pc() <= _binary->size() && !_halted
+               && !_memory.faulted()) {
+            cycle(static_cast<common::opcode>((*_binary)[_regs.pc()]));
+        }
+    });
     return static_cast<int>(_regs.ire());
 }
 
+/*
+ * Keeps the top two entries of the stack in locals, which the compiler can keep
+ * in host registers, instead of in the storage of the stack. push, pushc and
+ * pop are handled here, and only go to the storage when the cache is full or
+ * empty; every other instruction goes through cycle().
+ *
+ * sp always counts the cached entries, so instructions reading it are
+ * unaffected. Only the instructions accessing the storage of the stack need the
+ * cached entries to be written back first.
+ */
+auto vm::run_caching_stack_top() -> void {
+    using common::opcode;
+    std::uint64_t top[2];
+    std::uint64_t cached {0};
+    auto push = [&](std::uint64_t val) {
+        if (cached == 2) {
+            // Spill the deeper entry, which always fits as it is below sp
+            _stack.write_back(_regs.sp() - 2, top, 1);
+            top[0] = top[1];
+            cached = 1;
+        }
+        if (_regs.sp() == stack::capacity) {
+            _stack.write_back(_regs.sp() - cached, top, cached);
+            cached = 0;
+            // Throws the usual overflow error
+            _stack.push(val, _regs);
+        }
+        top[cached++] = val;
+        _regs.sp()++;
+    };
+
+    while (_regs.pc() <= _binary->size() && !_halted
+           && !_memory.faulted()) {
+        auto op = static_cast<opcode>((*_binary)[_regs.pc()]);
+        switch (op) {
+        case opcode::push: {
+            auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+            push(_regs[r1]);
+            _regs.advance_pc(2);
+            break;
+        }
+        case opcode::pushc: {
+            if (_binary->size() - _regs.pc() < 9) {
+                cycle(op);
+                break;
+            }
+            std::uint64_t val {0};
+            for (std::uint64_t i = 1; i <= 8; i++) {
+                val = val << 8 | (*_binary)[_regs.pc() + i];
+            }
+            push(val);
+            _regs.advance_pc(9);
+            break;
+        }
+        case opcode::pop: {
+            auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+            if (cached == 0 || registers::is_error_on_lhs(r1)) {
+                cycle(op);
+                break;
+            }
+            _regs[r1] = top[--cached];
+            _regs.sp()--;
+            _regs.advance_pc(2);
+            break;
+        }
+        case opcode::call:
+        case opcode::callr:
+        case opcode::ret:
+        case opcode::pushm:
+        case opcode::popm:
+        case opcode::ldsp:
+        case opcode::stsp:
+        case opcode::enter:
+        case opcode::leave:
+            _stack.write_back(_regs.sp() - cached, top, cached);
+            cached = 0;
+            cycle(op);
+            break;
+        default:
+            cycle(op);
+            break;
+        }
+    }
+}
+
 auto vm::read_preamble() -> void {
     std::size_t i {0};
     for (; i < sizeof(common::magic_byte_string) - 1; i++) {
@@ -87,10 +361,113 @@ auto vm::read_preamble() -> void {
     if (not ::is_version_compatible(major, minor, patch)) {
         throw preamble_error {preamble_error::kind::version_too_high};
     }
-    // TODO: read ~~the version +~~ :^) the features
+    // The features follow the version, and end with a ';' (or the padding, in
+    // older binaries)
+    auto memory_size = memory::default_size;
+    std::optional<std::uint64_t> heap_base;
+    _data_start = _binary->size();
+    for (; i < 256 && (*_binary)[i] != ';' && (*_binary)[i] != 0; i++) {
+        switch (static_cast<common::feature>((*_binary)[i])) {
+        case common::feature::memory: {
+            if (i + 8 >= 256) {
+                throw preamble_error {preamble_error::kind::unknown_feature};
+            }
+            memory_size = 0;
+            for (auto j = i + 1; j <= i + 8; j++) {
+                memory_size = memory_size << 8 | (*_binary)[j];
+            }
+            i += 8;
+            break;
+        }
+        case common::feature::data: {
+            if (i + 8 >= 256) {
+                throw preamble_error {preamble_error::kind::unknown_feature};
+            }
+            _data_start = 0;
+            for (auto j = i + 1; j <= i + 8; j++) {
+                _data_start = _data_start << 8 | (*_binary)[j];
+            }
+            if (_data_start < 256 || _data_start > _binary->size()) {
+                throw preamble_error {preamble_error::kind::bad_data_section};
+            }
+            i += 8;
+            break;
+        }
+        case common::feature::heap: {
+            if (i + 8 >= 256) {
+                throw preamble_error {preamble_error::kind::unknown_feature};
+            }
+            heap_base = 0;
+            for (auto j = i + 1; j <= i + 8; j++) {
+                heap_base = heap_base.value() << 8 | (*_binary)[j];
+            }
+            i += 8;
+            break;
+        }
+        default:
+            throw preamble_error {preamble_error::kind::unknown_feature};
+        }
+    }
+    if (not memory::is_valid_size(memory_size)) {
+        throw preamble_error {preamble_error::kind::bad_memory_size};
+    }
+    _memory.commit(memory_size);
+    // Unless told otherwise, the heap is the upper half of the memory
+    if (not heap_base.has_value()) {
+        heap_base = memory_size
+                    - memory_size / 2 / memory::granularity * memory::granularity;
+    } else if (heap_base.value() == 0 || heap_base.value() > memory_size
+               || heap_base.value() % memory::granularity != 0) {
+        throw preamble_error {preamble_error::kind::bad_heap_base};
+    }
+    _heap.reset(heap_base.value(), memory_size);
     _regs.jump_to(256);
 }
 
+auto vm::find_instruction_boundaries() -> void {
+    // The data section is not code
+    const auto size = _data_start;
+    auto read_u64   = [this](std::uint64_t at) {
+        std::uint64_t val {0};
+        for (auto i = at; i < at + 8; i++) {
+            val = val << 8 | (*_binary)[i];
+        }
+        return val;
+    };
+
+    _boundaries.assign(size, false);
+    std::vector<std::uint64_t> table_targets;
+    for (std::uint64_t pc = 256; pc < size;) {
+        auto op     = static_cast<common::opcode>((*_binary)[pc]);
+        auto length = instruction_size(op);
+        if (length == 0 || size - pc < length) {
+            // Not an instruction, so there is nothing left to jump to
+            break;
+        }
+        if (op == common::opcode::jtab) {
+            auto count = read_u64(pc + 2);
+            if (count > (size - pc - length) / 8) {
+                break;
+            }
+            for (std::uint64_t i = 0; i < count; i++) {
+                table_targets.push_back(read_u64(pc + length + 8 * i));
+            }
+            length += 8 * count;
+        }
+        _boundaries[pc] = true;
+        pc += length;
+    }
+
+    for (auto target : table_targets) {
+        if (not is_instruction_boundary(target)) {
+            throw bad_argument {
+                "A jump table in the binary targets address "
+                + std::to_string(target)
+                + ", which is not the start of an instruction."};
+        }
+    }
+}
+
 auto vm::cycle(common::opcode op) -> void {
 #define CHECK_LHS_REG(opcode, reg)                                             \
     do {                                                                       \
@@ -101,15 +478,24 @@ auto vm::cycle(common::opcode op) -> void {
         }                                                                      \
     } while (0)
 
-#define MAKE_8_BYTE_VAL(val)                                                   \
-    auto val = static_cast<std::uint64_t>((*_binary)[_regs.pc() + 1]) << 56    \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 2]) << 48  \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 3]) << 40  \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 4]) << 32  \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 5]) << 24  \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 6]) << 16  \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 7]) << 8   \
-               | static_cast<std::uint64_t>((*_binary)[_regs.pc() + 8])
+#define MAKE_8_BYTE_VAL_AT(val, offset)                                        \
+    auto val =                                                                 \
+        static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset)]) << 56    \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 1])    \
+              << 48                                                            \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 2])    \
+              << 40                                                            \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 3])    \
+              << 32                                                            \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 4])    \
+              << 24                                                            \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 5])    \
+              << 16                                                            \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 6])    \
+              << 8                                                             \
+        | static_cast<std::uint64_t>((*_binary)[_regs.pc() + (offset) + 7])
+
+#define MAKE_8_BYTE_VAL(val) MAKE_8_BYTE_VAL_AT(val, 1)
 
 #define CHECK_AT_LEAST_8_BYTES(opcode)                                         \
     if (_binary->size() - _regs.pc() < 8) {                                    \
@@ -120,6 +506,30 @@ auto vm::cycle(common::opcode op) -> void {
             "build its argument."};                                            \
     }
 
+#define CHECK_REG_AND_8_BYTES(opcode)                                          \
+    if (_binary->size() - _regs.pc() < 10) {                                   \
+        throw bad_argument {                                                   \
+            "Opcode '" #opcode "' is too close to the end of your binary, "    \
+            "there are not enough bytes after it to build a register and an "  \
+            "8-byte argument."};                                               \
+    }
+
+#define CHECK_INPUT_RANGE(opcode, offset, count)                               \
+    if (not _input || (offset) > _input->size()                                \
+        || _input->size() - (offset) < (count)) {                              \
+        throw bad_argument {"Opcode '" #opcode                                 \
+                            "' has tried to read past the end of the mapped "  \
+                            "input."};                                         \
+    }
+
+#define CHECK_DATA_RANGE(opcode, offset, count)                                \
+    if ((offset) < _data_start || (offset) > _binary->size()                   \
+        || _binary->size() - (offset) < (count)) {                             \
+        throw bad_argument {"Opcode '" #opcode                                 \
+                            "' has tried to read outside of the data "         \
+                            "section."};                                       \
+    }
+
     switch (op) {
         using common::opcode;
     case opcode::noop: {
@@ -170,6 +580,47 @@ auto vm::cycle(common::opcode op) -> void {
             io::putn(_regs[reg]);
             break;
         }
+        case io_op::putf: {
+            auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            io::putf(_regs.floating_point(reg));
+            break;
+        }
+        case io_op::getf: {
+            auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            _regs.floating_point(reg) = io::getf();
+            break;
+        }
+        case io_op::getn: {
+            auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            if (registers::is_error_on_lhs(reg)) {
+                throw invalid_register {
+                    "Invalid lhs register for opcode 'io getn':",
+                    static_cast<common::registers>((*_binary)[_regs.pc() + 2])};
+            }
+            auto num        = io::getn();
+            _regs[reg]      = num.value_or(0);
+            _flags.cmp_flag = static_cast<std::uint64_t>(
+                num.has_value() ? flags::cf::eq : flags::cf::gr);
+            break;
+        }
+        case io_op::putns: {
+            auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            io::putns(_regs[reg]);
+            break;
+        }
+        case io_op::setsep: {
+            auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            io::set_separator(_regs[reg]);
+            break;
+        }
+        case io_op::putm: {
+            // The address is in the lower half of the register, the length in
+            // the upper half
+            auto reg   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+            auto count = _regs[reg] >> 32;
+            io::putm(_memory.view(_regs[reg], count), count);
+            break;
+        }
         }
         _regs.advance_pc(3);
         break;
@@ -178,6 +629,7 @@ auto vm::cycle(common::opcode op) -> void {
         auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
         CHECK_LHS_REG(add, r1);
         auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _flags.carry_flag = _regs[r1] + _regs[r2] < _regs[r1];
         _regs[r1] += _regs[r2];
         _regs.advance_pc(3);
         break;
@@ -186,6 +638,7 @@ auto vm::cycle(common::opcode op) -> void {
         auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
         CHECK_LHS_REG(sub, r1);
         auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _flags.carry_flag = _regs[r1] < _regs[r2];
         _regs[r1] -= _regs[r2];
         _regs.advance_pc(3);
         break;
@@ -375,7 +828,971 @@ auto vm::cycle(common::opcode op) -> void {
         break;
     }
 #undef U64
+    case opcode::mov: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(mov, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _regs[r2];
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::movi: {
+        CHECK_REG_AND_8_BYTES(movi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(movi, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] = val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::addi: {
+        CHECK_REG_AND_8_BYTES(addi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(addi, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] += val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::subi: {
+        CHECK_REG_AND_8_BYTES(subi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(subi, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] -= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::muli: {
+        CHECK_REG_AND_8_BYTES(muli);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(muli, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] *= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::andi: {
+        CHECK_REG_AND_8_BYTES(andi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(andi, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] &= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::ori: {
+        CHECK_REG_AND_8_BYTES(ori);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(ori, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] |= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::xori: {
+        CHECK_REG_AND_8_BYTES(xori);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(xori, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] ^= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::shli: {
+        CHECK_REG_AND_8_BYTES(shli);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(shli, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] <<= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::shri: {
+        CHECK_REG_AND_8_BYTES(shri);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(shri, r1);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+        _regs[r1] >>= val;
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::cmpi: {
+        CHECK_REG_AND_8_BYTES(cmpi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        MAKE_8_BYTE_VAL_AT(val, 2);
+
+        if (_regs[r1] < val) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::less);
+        } else if (_regs[r1] > val) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::gr);
+        } else {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::eq);
+        }
+
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::add3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(add3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] + _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::sub3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(sub3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] - _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mul3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(mul3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] * _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::div3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(div3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] / _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mod3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(mod3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] % _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::and3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(and3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] & _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::or3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(or3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] | _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::xor3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(xor3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] ^ _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::lshft3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(lshft3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] << _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::rshft3: {
+        auto rd  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(rshft3, rd);
+        auto rs1 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto rs2 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[rd] = _regs[rs1] >> _regs[rs2];
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::load8: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(load8, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _memory.load<std::uint8_t>(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::load16: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(load16, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _memory.load<std::uint16_t>(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::load32: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(load32, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _memory.load<std::uint32_t>(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::load64: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(load64, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _memory.load<std::uint64_t>(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::store8: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.store<std::uint8_t>(_regs[r1], static_cast<std::uint8_t>(_regs[r2]));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::store16: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.store<std::uint16_t>(_regs[r1], static_cast<std::uint16_t>(_regs[r2]));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::store32: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.store<std::uint32_t>(_regs[r1], static_cast<std::uint32_t>(_regs[r2]));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::store64: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.store<std::uint64_t>(_regs[r1], _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::insize: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(insize, r1);
+        _regs[r1] = _input ? _input->size() : 0;
+        _regs.advance_pc(2);
+        break;
+    }
+    case opcode::inload8: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(inload8, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_INPUT_RANGE(inload8, _regs[r2], 1);
+        std::uint8_t val;
+        std::memcpy(&val, _input->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::inload16: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(inload16, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_INPUT_RANGE(inload16, _regs[r2], 2);
+        std::uint16_t val;
+        std::memcpy(&val, _input->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::inload32: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(inload32, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_INPUT_RANGE(inload32, _regs[r2], 4);
+        std::uint32_t val;
+        std::memcpy(&val, _input->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::inload64: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(inload64, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_INPUT_RANGE(inload64, _regs[r2], 8);
+        std::uint64_t val;
+        std::memcpy(&val, _input->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::vec: {
+        using common::vec_op;
+        auto sub_op = simd::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto width  = simd::lane_width_of(sub_op);
+        auto r1     = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r2     = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        switch (simd::family_of(sub_op)) {
+        case vec_op::add8:
+            _simd->add[width](_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::sub8:
+            _simd->sub[width](_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::mul8:
+            _simd->mul[width](_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::shl8:
+            _simd->shl[width](_regs.vector(r1), _regs[r2]);
+            break;
+        case vec_op::shr8:
+            _simd->shr[width](_regs.vector(r1), _regs[r2]);
+            break;
+        case vec_op::cmpeq8:
+            _simd->cmpeq[width](_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::cmpgt8:
+            _simd->cmpgt[width](_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::bcast8:
+            simd::broadcast(_regs.vector(r1), _regs[r2], width);
+            break;
+        case vec_op::hsum8:
+            CHECK_LHS_REG(vec hsum, r1);
+            _regs[r1] = simd::horizontal_sum(_regs.vector(r2), width);
+            break;
+        case vec_op::and_:
+            _simd->and_(_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::or_:
+            _simd->or_(_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::xor_:
+            _simd->xor_(_regs.vector(r1), _regs.vector(r2));
+            break;
+        case vec_op::load:
+            _memory.load_bytes(_regs[r2], _regs.vector(r1).bytes,
+                               sizeof(vector_register));
+            break;
+        case vec_op::store:
+            _memory.store_bytes(_regs[r1], _regs.vector(r2).bytes,
+                                sizeof(vector_register));
+            break;
+        default:
+            UNREACHABLE("vm::cycle: vec_op family was not handled");
+        }
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mcpy: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _memory.copy(_regs[r1], _regs[r2], _regs[r3]);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mset: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _memory.fill(_regs[r1], static_cast<std::uint8_t>(_regs[r2]),
+                     _regs[r3]);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mcmp: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+
+        auto result = _memory.compare(_regs[r1], _regs[r2], _regs[r3]);
+        if (result < 0) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::less);
+        } else if (result > 0) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::gr);
+        } else {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::eq);
+        }
+
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::mchr: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(mchr, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[r1] = _memory.find(
+            _regs[r1], static_cast<std::uint8_t>(_regs[r2]), _regs[r3]);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::sort: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.sort(_regs[r1], _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::sortkv: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _memory.sort_pairs(_regs[r1], _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::bsearch: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(bsearch, r1);
+        auto r2    = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3    = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto end   = _regs[r1] + _regs[r2] * 8;
+        auto found = _memory.lower_bound(_regs[r1], _regs[r2], _regs[r3]);
+        _flags.cmp_flag = static_cast<std::uint64_t>(
+            found != end && _memory.load<std::uint64_t>(found) == _regs[r3]
+                ? flags::cf::eq
+                : flags::cf::gr);
+        _regs[r1] = found;
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::dload8: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(dload8, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_DATA_RANGE(dload8, _regs[r2], 1);
+        std::uint8_t val;
+        std::memcpy(&val, _binary->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::dload16: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(dload16, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_DATA_RANGE(dload16, _regs[r2], 2);
+        std::uint16_t val;
+        std::memcpy(&val, _binary->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::dload32: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(dload32, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_DATA_RANGE(dload32, _regs[r2], 4);
+        std::uint32_t val;
+        std::memcpy(&val, _binary->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::dload64: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(dload64, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_DATA_RANGE(dload64, _regs[r2], 8);
+        std::uint64_t val;
+        std::memcpy(&val, _binary->data() + _regs[r2], sizeof(val));
+        _regs[r1] = from_little_endian(val);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::dcpy: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        CHECK_DATA_RANGE(dcpy, _regs[r2], _regs[r3]);
+        _memory.copy_in(_regs[r1], _binary->data() + _regs[r2], _regs[r3]);
+        _regs.advance_pc(4);
+        break;
+    }
+    /*
+     * Blocks of memory (the path of fopen, the buffers of fread and fwrite)
+     * are passed like to `io putm`: the address in the lower half of the
+     * register and the length in the upper half.
+     */
+    case opcode::fopen: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(fopen, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+
+        auto count      = _regs[r2] >> 32;
+        auto path       = _memory.view(_regs[r2], count);
+        auto handle     = _files.open({path, path + count}, _regs[r3]);
+        _regs[r1]       = handle.value_or(file_table::no_handle);
+        _flags.cmp_flag = static_cast<std::uint64_t>(
+            handle.has_value() ? flags::cf::eq : flags::cf::gr);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::fread: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(fread, r1);
+        auto r2   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3   = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        _regs[r1] = _files.read(_regs[r2], _memory, _regs[r3], _regs[r3] >> 32);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::fwrite: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(fwrite, r1);
+        auto r2    = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3    = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto count = _regs[r3] >> 32;
+        auto bytes = _memory.view(_regs[r3], count);
+        _regs[r1]  = _files.write(_regs[r2], bytes, count);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::fseek: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+
+        auto sought     = _files.seek(_regs[r1], _regs[r2]);
+        _flags.cmp_flag = static_cast<std::uint64_t>(sought ? flags::cf::eq
+                                                            : flags::cf::gr);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fclose: {
+        auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        _files.close(_regs[reg]);
+        _regs.advance_pc(2);
+        break;
+    }
+    case opcode::popcnt: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(popcnt, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::popcount(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::clz: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(clz, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::count_leading_zeros(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::ctz: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(ctz, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::count_trailing_zeros(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::bswap: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(bswap, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::byte_swap(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::rotl: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(rotl, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::rotate_left(_regs[r1], _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::rotr: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(rotr, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = bits::rotate_right(_regs[r1], _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::crc32: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(crc32, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] =
+            _crc32c(static_cast<std::uint32_t>(_regs[r1]), _regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::adc: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(adc, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto [sum, carry] =
+            bits::add_with_carry(_regs[r1], _regs[r2], _flags.carry_flag);
+        _regs[r1]         = sum;
+        _flags.carry_flag = carry;
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::sbb: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(sbb, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto [diff, borrow] =
+            bits::sub_with_borrow(_regs[r1], _regs[r2], _flags.carry_flag);
+        _regs[r1]         = diff;
+        _flags.carry_flag = borrow;
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::mulx: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(mulx, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_LHS_REG(mulx, r2);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto [high, low] = bits::multiply_wide(_regs[r2], _regs[r3]);
+        _regs[r2]        = low;
+        _regs[r1]        = high;
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::divmod: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(divmod, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        CHECK_LHS_REG(divmod, r2);
+        auto r3 = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto dividend = _regs[r2];
+        auto divisor  = _regs[r3];
+        _regs[r2]     = dividend % divisor;
+        _regs[r1]     = dividend / divisor;
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::callnative: {
+        CHECK_AT_LEAST_8_BYTES(callnative);
+        MAKE_8_BYTE_VAL(idx);
+        if (idx >= _natives.size()) {
+            throw bad_argument {"The binary has tried to call native function "
+                                + std::to_string(idx)
+                                + ", but only "
+                                + std::to_string(_natives.size())
+                                + " have been registered."};
+        }
+        _regs.ire() = _natives[idx](_regs.integer_function_args(), _memory);
+        _regs.advance_pc(9);
+        break;
+    }
+    case opcode::jmpr: {
+        auto r1     = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto target = _regs[r1];
+        if (not is_instruction_boundary(target)) {
+            throw bad_argument {"Opcode 'jmpr' has tried to jump to address "
+                                + std::to_string(target)
+                                + ", which is not the start of an "
+                                  "instruction."};
+        }
+        _regs.jump_to(target);
+        break;
+    }
+    case opcode::callr: {
+        auto r1     = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto target = _regs[r1];
+        if (not is_instruction_boundary(target)) {
+            throw bad_argument {"Opcode 'callr' has tried to call address "
+                                + std::to_string(target)
+                                + ", which is not the start of an "
+                                  "instruction."};
+        }
+        for (auto& gp : _regs.general_purpose()) {
+            gp = 0;
+        }
+        _stack.push(_regs.pc() + 2, _regs);
+        _regs.jump_to(target);
+        break;
+    }
+    case opcode::jtab: {
+        // The targets were checked when the binary was loaded, but only for
+        // the jump tables on instruction boundaries
+        if (not is_instruction_boundary(_regs.pc())) {
+            throw bad_argument {"Opcode 'jtab' was found at address "
+                                + std::to_string(_regs.pc())
+                                + ", which is not the start of an "
+                                  "instruction."};
+        }
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        MAKE_8_BYTE_VAL_AT(count, 2);
+        auto idx = _regs[r1];
+        if (idx >= count) {
+            // Out of range indices fall through, like the default of a switch
+            _regs.advance_pc(10 + 8 * count);
+            break;
+        }
+        MAKE_8_BYTE_VAL_AT(target, 10 + 8 * idx);
+        _regs.jump_to(target);
+        break;
+    }
+    case opcode::cmov: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(cmov, r1);
+        auto r2   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto mask = condition_mask((*_binary)[_regs.pc() + 3], _flags);
+        _regs[r1] = (_regs[r2] & mask) | (_regs[r1] & ~mask);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::csel: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(csel, r1);
+        auto r2   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3   = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto mask = condition_mask((*_binary)[_regs.pc() + 4], _flags);
+        _regs[r1] = (_regs[r2] & mask) | (_regs[r3] & ~mask);
+        _regs.advance_pc(5);
+        break;
+    }
+    case opcode::loop: {
+        CHECK_REG_AND_8_BYTES(loop);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(loop, r1);
+        if (--_regs[r1] != 0) {
+            MAKE_8_BYTE_VAL_AT(address, 2);
+            _regs.jump_to(address);
+            break;
+        }
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::tcall: {
+        CHECK_AT_LEAST_8_BYTES(tcall);
+        MAKE_8_BYTE_VAL(address);
+        // Like call, but the return address of the current function is left
+        // in place, so the callee returns straight to our caller
+        for (auto& gp : _regs.general_purpose()) {
+            gp = 0;
+        }
+        _regs.jump_to(address);
+        break;
+    }
+    case opcode::pushm: {
+        CHECK_AT_LEAST_8_BYTES(pushm);
+        MAKE_8_BYTE_VAL(mask);
+        _stack.push_many(mask, _regs);
+        _regs.advance_pc(9);
+        break;
+    }
+    case opcode::popm: {
+        CHECK_AT_LEAST_8_BYTES(popm);
+        MAKE_8_BYTE_VAL(mask);
+        _stack.pop_many(mask, _regs);
+        _regs.advance_pc(9);
+        break;
+    }
+    case opcode::ldsp: {
+        CHECK_REG_AND_8_BYTES(ldsp);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(ldsp, r1);
+        MAKE_8_BYTE_VAL_AT(offset, 2);
+        _regs[r1] = _stack.slot(offset, _regs);
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::stsp: {
+        CHECK_REG_AND_8_BYTES(stsp);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        MAKE_8_BYTE_VAL_AT(offset, 2);
+        _stack.slot(offset, _regs) = _regs[r1];
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::enter: {
+        CHECK_AT_LEAST_8_BYTES(enter);
+        MAKE_8_BYTE_VAL(count);
+        _stack.reserve(count, _regs);
+        _regs.advance_pc(9);
+        break;
+    }
+    case opcode::leave: {
+        CHECK_AT_LEAST_8_BYTES(leave);
+        MAKE_8_BYTE_VAL(count);
+        _stack.release(count, _regs);
+        _regs.advance_pc(9);
+        break;
+    }
+    case opcode::fmov: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) = _regs.floating_point(r2);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fmovi: {
+        CHECK_REG_AND_8_BYTES(fmovi);
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        MAKE_8_BYTE_VAL_AT(bits, 2);
+        std::memcpy(&_regs.floating_point(r1), &bits, sizeof(double));
+        _regs.advance_pc(10);
+        break;
+    }
+    case opcode::fadd: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) += _regs.floating_point(r2);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fsub: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) -= _regs.floating_point(r2);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fmul: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) *= _regs.floating_point(r2);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fdiv: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) /= _regs.floating_point(r2);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fsqrt: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) = std::sqrt(_regs.floating_point(r2));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::fma: {
+        auto r1  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2  = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3  = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto& fd = _regs.floating_point(r1);
+        fd = _fma(_regs.floating_point(r2), _regs.floating_point(r3), fd);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::fcmp: {
+        auto r1  = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2  = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto lhs = _regs.floating_point(r1);
+        auto rhs = _regs.floating_point(r2);
+        if (lhs < rhs) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::less);
+        } else if (lhs > rhs) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::gr);
+        } else if (lhs == rhs) {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::eq);
+        } else {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::unordered);
+        }
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::cvtif: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs.floating_point(r1) = fp::from_integer(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::cvtfi: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(cvtfi, r1);
+        auto r2   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = fp::to_integer(_regs.floating_point(r2));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::movif: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        std::memcpy(&_regs.floating_point(r1), &_regs[r2], sizeof(double));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::movfi: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(movfi, r1);
+        auto r2 = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        std::memcpy(&_regs[r1], &_regs.floating_point(r2), sizeof(double));
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::alloc: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(alloc, r1);
+        auto r2   = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        _regs[r1] = _heap.allocate(_regs[r2]);
+        _regs.advance_pc(3);
+        break;
+    }
+    case opcode::free: {
+        auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        _heap.deallocate(_regs[reg]);
+        _regs.advance_pc(2);
+        break;
+    }
+    case opcode::htnew: {
+        auto reg = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(htnew, reg);
+        _hash_tables.emplace_back();
+        _regs[reg] = _hash_tables.size() - 1;
+        _regs.advance_pc(2);
+        break;
+    }
+    case opcode::htput: {
+        auto r1       = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2       = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3       = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto replaced = hash_table_at(_regs[r1]).insert_or_assign(_regs[r2],
+                                                                  _regs[r3]);
+        _flags.cmp_flag = static_cast<std::uint64_t>(replaced ? flags::cf::eq
+                                                              : flags::cf::gr);
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::htget: {
+        auto r1 = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        CHECK_LHS_REG(htget, r1);
+        auto r2  = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto r3  = registers::parse_from_byte((*_binary)[_regs.pc() + 3]);
+        auto val = hash_table_at(_regs[r2]).find(_regs[r3]);
+        if (val) {
+            _regs[r1]       = *val;
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::eq);
+        } else {
+            _flags.cmp_flag = static_cast<std::uint64_t>(flags::cf::gr);
+        }
+        _regs.advance_pc(4);
+        break;
+    }
+    case opcode::htdel: {
+        auto r1      = registers::parse_from_byte((*_binary)[_regs.pc() + 1]);
+        auto r2      = registers::parse_from_byte((*_binary)[_regs.pc() + 2]);
+        auto removed = hash_table_at(_regs[r1]).erase(_regs[r2]);
+        _flags.cmp_flag = static_cast<std::uint64_t>(removed ? flags::cf::eq
+                                                             : flags::cf::gr);
+        _regs.advance_pc(3);
+        break;
+    }
     case opcode::halt: {
+        _heap.release_all();
         _halted = true;
         break;
     }
@@ -383,7 +1800,11 @@ auto vm::cycle(common::opcode op) -> void {
 
 #undef CHECK_LHS_REG
 #undef MAKE_8_BYTE_VAL
+#undef MAKE_8_BYTE_VAL_AT
 #undef CHECK_AT_LEAST_8_BYTES
+#undef CHECK_REG_AND_8_BYTES
+#undef CHECK_INPUT_RANGE
+#undef CHECK_DATA_RANGE
 }
 
 }   // namespace reqvm
@@ -26,10 +26,19 @@
 
 #include "../../common/opcodes.hpp"
 #include "binary_manager.hpp"
+#include "binary_managers/memory_mapped_file_backed.hpp"
+#include "bits.hpp"
+#include "files.hpp"
 #include "flags.hpp"
+#include "fp.hpp"
+#include "hash_table.hpp"
+#include "heap.hpp"
+#include "memory.hpp"
 #include "registers.hpp"
+#include "simd.hpp"
 #include "stack.hpp"
 
+#include <array>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -42,17 +51,67 @@ public:
     explicit vm(const std::string& binary);
     ~vm() noexcept = default;
 
+    // Maps `input` read-only, so the binary can access it with `inload*`
+    auto map_input(const std::string& input) -> void;
+
+    // A host function the binary can call with `callnative`. It gets the `ifa`
+    // registers and the linear memory, and its result is stored in `ire`
+    using native_function =
+        auto (*)(const std::array<std::uint64_t, 16>& args, memory& mem)
+            -> std::uint64_t;
+    // Returns the index `callnative` calls `function` with. Indices are handed
+    // out in registration order, starting at 0
+    auto register_native(native_function function) -> std::uint64_t;
+
+    // Runs the binary with the top entries of the stack cached in host
+    // registers, see run_caching_stack_top()
+    auto cache_stack_top(bool enable) noexcept -> void {
+        _cache_stack_top = enable;
+    }
+
+    // Only lets the binary open files inside the directory `root`
+    auto sandbox_files(const std::string& root) -> void {
+        _files.sandbox(root);
+    }
+
     auto run() -> int;
 
+    auto heap_statistics() const noexcept -> const heap::statistics& {
+        return _heap.stats();
+    }
+
 private:
     auto read_preamble() -> void;
+    // Decodes the binary to find where its instructions start, and checks
+    // that the targets of its jump tables are among them
+    auto find_instruction_boundaries() -> void;
+    auto is_instruction_boundary(std::uint64_t address) const noexcept
+        -> bool {
+        return address < _boundaries.size() && _boundaries[address];
+    }
     auto cycle(common::opcode op) -> void;
+    auto hash_table_at(std::uint64_t handle) -> hash_table&;
+    auto run_caching_stack_top() -> void;
 
     std::unique_ptr<binary_manager> _binary;
+    std::unique_ptr<mmf_backed_binary_manager> _input;
     registers _regs;
     stack _stack;
+    memory _memory;
+    heap _heap;
+    // Indexed by the handles htnew returns
+    std::vector<hash_table> _hash_tables;
+    file_table _files;
+    const simd::kernels* _simd;
+    bits::crc32c_kernel _crc32c;
+    fp::fma_kernel _fma;
+    std::vector<native_function> _natives;
+    std::vector<bool> _boundaries;
+    // The read-only data section spans from here to the end of the binary
+    std::uint64_t _data_start {0};
     flags _flags;
     bool _halted {false};
+    bool _cache_stack_top {false};
 };
 
 }   // namespace reqvm